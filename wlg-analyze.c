@@ -0,0 +1,477 @@
+/*
+This file is part of wlg - A pretty simple workload mix generator
+Copyright (C) 2014 Patrick Bellasi <derkling@gmail.com>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+/*
+ * wlg-analyze - Offline analysis of wlg binary events logs
+ *
+ * Reads the per-worker files written by "wlg --log DIR" and reports
+ * per-worker and global summaries, a wakeup latency histogram and a
+ * timeline of the activity of all the workers, together with the CPUs
+ * throttling intervals detected by the sampler ("wlg --sample").
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "wlg_log.h"
+
+#define US_TO_NS 1000
+#define MS_TO_NS 1000000
+
+#define HIST_BUCKETS 40
+#define CPUS_MAX     1024
+
+static int conf_summary = 0;
+static int conf_histogram = 0;
+static uint32_t conf_timeline_ms = 0;
+
+struct log_file {
+	const char *path;
+	struct wlg_log_header *hdr;
+	struct wlg_log_event *events;
+	size_t size;
+};
+
+/* Wakeup latencies of a set of events */
+struct latencies {
+	uint32_t *values;
+	uint64_t count;
+	uint64_t capacity;
+	uint64_t sum;
+};
+
+static void
+barf(const char *msg)
+{
+	fprintf(stderr, "%s (error: %s)\n", msg, strerror(errno));
+	exit(1);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Logs loading
+////////////////////////////////////////////////////////////////////////////////
+
+static int
+log_load(struct log_file *log, const char *path)
+{
+	struct stat st;
+	void *map;
+	int fd;
+
+	log->path = path;
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st)) {
+		fprintf(stderr, "%s: cannot open (error: %s)\n", path,
+			strerror(errno));
+		return -1;
+	}
+
+	if ((uint64_t)st.st_size < sizeof(struct wlg_log_header)) {
+		fprintf(stderr, "%s: not a wlg events log\n", path);
+		close(fd);
+		return -1;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		barf("mmap:");
+
+	log->hdr = map;
+	log->size = st.st_size;
+	if (memcmp(log->hdr->magic, WLG_LOG_MAGIC, sizeof(log->hdr->magic)) ||
+			log->hdr->version < 1 ||
+			log->hdr->version > WLG_LOG_VERSION ||
+			log->hdr->record_size != sizeof(struct wlg_log_event)) {
+		fprintf(stderr, "%s: unsupported events log format\n", path);
+		munmap(map, st.st_size);
+		return -1;
+	}
+
+	/* Logs of a killed wlg have not been finalized */
+	if (log->hdr->header_size + log->hdr->count * log->hdr->record_size
+			> (uint64_t)st.st_size) {
+		fprintf(stderr, "%s: truncated events log\n", path);
+		munmap(map, st.st_size);
+		return -1;
+	}
+
+	log->events = (struct wlg_log_event *)
+		((char *)map + log->hdr->header_size);
+
+	return 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Statistics
+////////////////////////////////////////////////////////////////////////////////
+
+static void
+latencies_add(struct latencies *lat, uint32_t value)
+{
+	if (lat->count == lat->capacity) {
+		lat->capacity = lat->capacity ? 2 * lat->capacity : 4096;
+		lat->values = realloc(lat->values,
+				lat->capacity * sizeof(uint32_t));
+		if (!lat->values)
+			barf("realloc:");
+	}
+	lat->values[lat->count++] = value;
+	lat->sum += value;
+}
+
+static int
+compare_u32(const void *a, const void *b)
+{
+	uint32_t va = *(const uint32_t *)a;
+	uint32_t vb = *(const uint32_t *)b;
+
+	return (va > vb) - (va < vb);
+}
+
+/* Return the q-quantile of a sorted set of latencies, in [us] */
+static double
+latencies_quantile(struct latencies *lat, double q)
+{
+	uint64_t idx;
+
+	if (!lat->count)
+		return 0;
+	idx = q * (lat->count - 1);
+
+	return (double)lat->values[idx] / US_TO_NS;
+}
+
+static void
+latencies_print(const char *name, struct latencies *lat)
+{
+	if (!lat->count)
+		return;
+
+	qsort(lat->values, lat->count, sizeof(uint32_t), compare_u32);
+	printf("%-16s %9llu wakeups, latency [us]: min %9.3f avg %9.3f"
+		" p50 %9.3f p99 %9.3f p99.9 %9.3f max %9.3f\n",
+		name, (unsigned long long)lat->count,
+		latencies_quantile(lat, 0),
+		(double)lat->sum / lat->count / US_TO_NS,
+		latencies_quantile(lat, 0.50),
+		latencies_quantile(lat, 0.99),
+		latencies_quantile(lat, 0.999),
+		latencies_quantile(lat, 1));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Reports
+////////////////////////////////////////////////////////////////////////////////
+
+/* Throttling intervals detected by the sampler */
+static void
+report_throttling(struct log_file *log)
+{
+	struct wlg_log_event *event;
+	uint64_t intervals = 0, throttled_ns = 0, start_ns = 0, e;
+
+	/* The END argument saturates at ~4.3 [s], use the timestamps */
+	for (e = 0; e < log->hdr->count; ++e) {
+		event = log->events + e;
+		if (event->type == WLG_EV_THROTTLE_START)
+			start_ns = event->ts_ns;
+		if (event->type != WLG_EV_THROTTLE_END)
+			continue;
+		++intervals;
+		throttled_ns += event->ts_ns - start_ns;
+	}
+
+	printf("%-16s %9llu throttling intervals, throttled %12.3f [ms]\n",
+		log->hdr->name, (unsigned long long)intervals,
+		(double)throttled_ns / MS_TO_NS);
+}
+
+static void
+report_summary(struct log_file *logs, int count)
+{
+	static uint8_t cpus[CPUS_MAX];
+	struct latencies all = { 0 };
+	struct latencies lat;
+	struct wlg_log_event *event;
+	uint64_t activations, busy_ns, migrations, e;
+	uint32_t cpus_used;
+	int16_t last_cpu;
+	int i;
+
+	printf("Summary:\n");
+	for (i = 0; i < count; ++i) {
+		if (logs[i].hdr->kind == WLG_LOG_KIND_SAMPLER) {
+			report_throttling(logs + i);
+			continue;
+		}
+		memset(&lat, 0, sizeof(lat));
+		memset(cpus, 0, sizeof(cpus));
+		activations = busy_ns = migrations = 0;
+		cpus_used = 0;
+		last_cpu = -1;
+
+		for (e = 0; e < logs[i].hdr->count; ++e) {
+			event = logs[i].events + e;
+
+			if (event->cpu >= 0 && event->cpu < CPUS_MAX &&
+					!cpus[event->cpu]) {
+				cpus[event->cpu] = 1;
+				++cpus_used;
+			}
+			if (last_cpu >= 0 && event->cpu != last_cpu)
+				++migrations;
+			last_cpu = event->cpu;
+
+			switch (event->type) {
+			case WLG_EV_WAKEUP:
+				latencies_add(&lat, event->arg);
+				latencies_add(&all, event->arg);
+				break;
+			case WLG_EV_END:
+				++activations;
+				busy_ns += event->arg;
+				break;
+			}
+		}
+
+		printf("%-16s %9llu events, %9llu activations, busy %12.3f [ms],"
+			" %4u CPUs, %9llu migrations\n",
+			logs[i].hdr->name,
+			(unsigned long long)logs[i].hdr->count,
+			(unsigned long long)activations,
+			(double)busy_ns / MS_TO_NS, cpus_used,
+			(unsigned long long)migrations);
+		latencies_print(logs[i].hdr->name, &lat);
+		free(lat.values);
+	}
+
+	latencies_print("all", &all);
+	free(all.values);
+}
+
+/* Wakeup latencies distribution on power of two buckets */
+static void
+report_histogram(struct log_file *logs, int count)
+{
+	uint64_t buckets[HIST_BUCKETS] = { 0 };
+	uint64_t total = 0, max = 0, e;
+	uint32_t value;
+	int i, b, last = 0;
+
+	for (i = 0; i < count; ++i) {
+		for (e = 0; e < logs[i].hdr->count; ++e) {
+			if (logs[i].events[e].type != WLG_EV_WAKEUP)
+				continue;
+			value = logs[i].events[e].arg / US_TO_NS;
+			for (b = 0; value && b < HIST_BUCKETS - 1; ++b)
+				value >>= 1;
+			++buckets[b];
+			++total;
+		}
+	}
+
+	if (!total)
+		return;
+
+	for (b = 0; b < HIST_BUCKETS; ++b) {
+		if (buckets[b] > max)
+			max = buckets[b];
+		if (buckets[b])
+			last = b;
+	}
+
+	printf("Wakeup latency histogram:\n");
+	for (b = 0; b <= last; ++b) {
+		printf("  < %10llu [us] %10llu %6.2f%% |%.*s\n",
+			1ULL << b, (unsigned long long)buckets[b],
+			100.0 * buckets[b] / total,
+			(int)(50 * buckets[b] / max),
+			"##################################################");
+	}
+}
+
+/* Workers activity on fixed size time bins */
+static void
+report_timeline(struct log_file *logs, int count)
+{
+	struct wlg_log_event *event;
+	uint64_t bin_ns = (uint64_t)conf_timeline_ms * MS_TO_NS;
+	uint64_t end_ns = 0, e;
+	uint64_t *wakeups, *activations, *busy_ns, *lat_max, *throttled_ns;
+	uint64_t throttle_start, from, to;
+	uint32_t bins, b;
+	int i;
+
+	for (i = 0; i < count; ++i) {
+		if (!logs[i].hdr->count)
+			continue;
+		event = logs[i].events + logs[i].hdr->count - 1;
+		if (event->ts_ns > end_ns)
+			end_ns = event->ts_ns;
+	}
+	bins = end_ns / bin_ns + 1;
+
+	wakeups = calloc(bins, sizeof(uint64_t));
+	activations = calloc(bins, sizeof(uint64_t));
+	busy_ns = calloc(bins, sizeof(uint64_t));
+	lat_max = calloc(bins, sizeof(uint64_t));
+	throttled_ns = calloc(bins, sizeof(uint64_t));
+	if (!wakeups || !activations || !busy_ns || !lat_max || !throttled_ns)
+		barf("calloc:");
+
+	for (i = 0; i < count; ++i) {
+		throttle_start = 0;
+		for (e = 0; e < logs[i].hdr->count; ++e) {
+			event = logs[i].events + e;
+			b = event->ts_ns / bin_ns;
+			switch (event->type) {
+			case WLG_EV_THROTTLE_START:
+				throttle_start = event->ts_ns;
+				break;
+			case WLG_EV_THROTTLE_END:
+				/* Spread the interval over the bins it overlaps */
+				for (from = throttle_start; from < event->ts_ns; from = to) {
+					to = (from / bin_ns + 1) * bin_ns;
+					if (to > event->ts_ns)
+						to = event->ts_ns;
+					throttled_ns[from / bin_ns] += to - from;
+				}
+				break;
+			case WLG_EV_WAKEUP:
+				++wakeups[b];
+				if (event->arg > lat_max[b])
+					lat_max[b] = event->arg;
+				break;
+			case WLG_EV_END:
+				++activations[b];
+				busy_ns[b] += event->arg;
+				break;
+			}
+		}
+	}
+
+	printf("Timeline (%u [ms] bins):\n", conf_timeline_ms);
+	printf("  %12s %10s %12s %14s %14s %14s\n", "time [ms]", "wakeups",
+		"activations", "busy [ms]", "max lat [us]", "throttled [ms]");
+	for (b = 0; b < bins; ++b) {
+		printf("  %12llu %10llu %12llu %14.3f %14.3f %14.3f\n",
+			(unsigned long long)b * conf_timeline_ms,
+			(unsigned long long)wakeups[b],
+			(unsigned long long)activations[b],
+			(double)busy_ns[b] / MS_TO_NS,
+			(double)lat_max[b] / US_TO_NS,
+			(double)throttled_ns[b] / MS_TO_NS);
+	}
+
+	free(wakeups);
+	free(activations);
+	free(busy_ns);
+	free(lat_max);
+	free(throttled_ns);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Main
+////////////////////////////////////////////////////////////////////////////////
+
+static void
+print_usage(char *prog)
+{
+	fprintf(stderr, " \n");
+	fprintf(stderr, "Usage: %s <options> <log files>\n", prog);
+	fprintf(stderr, " \n");
+	fprintf(stderr, " <options>:\n");
+	fprintf(stderr, "   -s    - per-worker and global summary (default)\n");
+	fprintf(stderr, "   -H    - wakeup latency histogram\n");
+	fprintf(stderr, "   -t MS - activity timeline on MS [ms] bins\n");
+	fprintf(stderr, " \n");
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct log_file *logs;
+	int count = 0;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "hHst:")) != -1) {
+		switch (c) {
+		case 's':
+			conf_summary = 1;
+			break;
+		case 'H':
+			conf_histogram = 1;
+			break;
+		case 't':
+			if (sscanf(optarg, "%u", &conf_timeline_ms) < 1 ||
+					!conf_timeline_ms) {
+				fprintf(stderr, "Wrong timeline bin size\n");
+				exit(-1);
+			}
+			break;
+		case 'h':
+			print_usage(argv[0]);
+			exit(0);
+		default:
+			print_usage(argv[0]);
+			exit(-1);
+		}
+	}
+
+	if (optind == argc) {
+		print_usage(argv[0]);
+		exit(-1);
+	}
+	if (!conf_histogram && !conf_timeline_ms)
+		conf_summary = 1;
+
+	logs = calloc(argc - optind, sizeof(struct log_file));
+	if (!logs)
+		barf("calloc:");
+	for (i = optind; i < argc; ++i)
+		if (!log_load(logs + count, argv[i]))
+			++count;
+	if (!count)
+		exit(-1);
+
+	if (conf_summary)
+		report_summary(logs, count);
+	if (conf_histogram)
+		report_histogram(logs, count);
+	if (conf_timeline_ms)
+		report_timeline(logs, count);
+
+	for (i = 0; i < count; ++i)
+		munmap(logs[i].hdr, logs[i].size);
+	free(logs);
+
+	return 0;
+}
@@ -16,18 +16,37 @@ this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
 Street, Fifth Floor, Boston, MA  02110-1301, USA.
 */
 
+#define _GNU_SOURCE
+
 #include <errno.h>
+#include <fcntl.h>
 #include <getopt.h>
+#include <limits.h>
+#include <math.h>
+#include <poll.h>
 #include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <linux/futex.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
 #include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
 #include <sys/syscall.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
+#include <sys/wait.h>
+
+#include "wlg_log.h"
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
 
 #ifdef DEBUG
 # define DB(x) x
@@ -76,18 +95,167 @@ static uint8_t conf_bw = 0; // BATCH workers count
 static uint8_t conf_iw = 0; // INTERACTIVE workers count
 static uint8_t conf_pw = 0; // PERIODIC workers count
 static uint8_t conf_yw = 0; // YIELD workers count
+static uint8_t conf_fw = 0; // FOOTPRINT workers count
+static uint8_t conf_mw = 0; // MISPREDICT workers count
+static uint8_t conf_cw = 0; // CONTENTION workers count
+static uint8_t conf_xw = 0; // HANDOFF workers pairs count
+static uint8_t conf_gw = 0; // GRAPH workers (DAG nodes) count
+static uint8_t conf_aw = 0; // AUDIO workers pairs count
+static uint8_t conf_tw = 0; // THREAD churn workers count
+static uint8_t conf_ew = 0; // EXEC storm workers count
 static uint8_t conf_tm = 0;
-static uint8_t conf_td = 5; // Test duration
+static uint32_t conf_td = 5; // Test duration [s]
+static uint32_t conf_phases = 1; // Test phases, run by the same workers
+static int conf_pool = 0;    // Run trials as phases of the same workers
 static struct timespec start_ts;
 static char *conf_iparams;
 static char *conf_pparams;
 static char *conf_yparams;
+static char *conf_fparams;
+static char *conf_mparams;
+static char *conf_cparams;
+static char *conf_xparams;
+static char *conf_gparams;
+static char *conf_aparams;
+static char *conf_tparams;
+static char *conf_eparams;
 static float start_us = 0;
+static uint32_t conf_attr_us = 0;      // Latency attribution threshold
+static uint32_t conf_attr_records = 4096; // Occupancy records per worker
+static char *conf_log_dir = NULL;      // Binary events log folder
+static uint32_t conf_trials = 0;       // Trials per configuration
+static uint32_t conf_trials_warmup = 1; // Trials discarded per configuration
+static char *conf_compare = NULL;      // B configuration of an A/B comparison
+static int conf_metrics_fd = -1;       // Where a trial reports its metrics
+static char conf_sweep = 0;            // Kind of workers to sweep (option)
+static uint32_t conf_sweep_factor = 2; // Sweep up to these times the CPUs
+static uint32_t conf_sweep_point = 0;  // Workers count of a sweep point
+static uint32_t conf_probe_us = 0;     // Probe worker period
+static double conf_rate = 0;           // Open-loop requests rate [1/s]
+static char *conf_rate_sweep = NULL;   // Requests rates to sweep, and SLO
+static double rate_sweep_from = 0;     // First swept requests rate [1/s]
+static double rate_sweep_step = 0;     // Swept requests rate increment [1/s]
+static uint32_t rate_sweep_slo_us = 0; // Response times p99 objective
+static int conf_sleep = 0;             // Sleep mechanisms set by the user
+static uint32_t conf_spin_margin_us = 0; // I and P workers spin up to deadlines
+
+/* Workload options of the kinds of workers, in worker_kind order */
+#define SWEEP_KINDS "bipyfmcxgate"
+static uint32_t conf_warmup_ms = 0;    // Initial time not accounted in stats
+static uint32_t conf_cooldown_ms = 0;  // Final time not accounted in stats
+static uint64_t meas_start_ns = 0;     // Measurement window begin
+static uint64_t meas_end_ns = UINT64_MAX; // Measurement window end
+static int conf_calibrate = 0;         // Run the CPUs capacity calibration
+static char *conf_calib_file = "wlg.calib"; // CPUs capacity calibration cache
+static char *conf_power_model = NULL;  // CPUs power model file
+static uint32_t conf_pelt_ms = 0;      // Load tracking sampling period
+static uint64_t conf_seed = 0;         // Master random seed
+static int conf_seed_set = 0;          // Master random seed from the user
+static char *conf_sched_dump = NULL;   // Activations schedule to write
+static char *conf_sched_replay = NULL; // Activations schedule to replay
+static char *conf_pelt_file = "wlg_pelt.csv"; // Load tracking time series
+static int conf_invariant = 0;         // Bursts in reference CPU time
+static double ref_iterations_per_us = 0; // Reference CPU speed
+static uint32_t conf_sample_ms = 0;    // CPUs frequency sampling period
 static uint32_t pid = 0;
 
-/* Workers synchronized start support */
-pthread_mutex_t start_mtx = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t  start_cv = PTHREAD_COND_INITIALIZER;
+/* Size of the coherency unit, i.e. what a cache line bounces */
+#define CACHELINE_SIZE 64
+
+/*
+ * Bounded memory quantiles sketch
+ *
+ * Values are counted on log-linear buckets (HDR histogram style): each power
+ * of two range is split in 2^SKETCH_SUB_BITS linear buckets, thus quantiles
+ * are reported with a relative error below 1/2^SKETCH_SUB_BITS whatever the
+ * number of samples. Count, sum, min and max are tracked exactly.
+ * Sketches are merged by just adding up their buckets.
+ */
+#define SKETCH_SUB_BITS  6
+#define SKETCH_SUB_COUNT (1 << SKETCH_SUB_BITS)
+/* Values above 2^(SKETCH_SHIFTS + SKETCH_SUB_BITS) (~18 [min] in [ns])
+ * are accounted in the last bucket */
+#define SKETCH_SHIFTS    34
+#define SKETCH_BUCKETS   ((SKETCH_SHIFTS + 1) * SKETCH_SUB_COUNT)
+
+struct sketch {
+	uint64_t count;
+	uint64_t sum;
+	uint64_t min;
+	uint64_t max;
+	uint64_t buckets[SKETCH_BUCKETS];
+};
+
+/* Time taken by reference CPU time bursts started on a CPU */
+struct burst_stats {
+	uint64_t count;
+	uint64_t ref_ns;
+	uint64_t run_ns;
+};
+
+/* A worker was running on a CPU within a time interval */
+struct occupancy {
+	uint64_t start_ns;
+	uint64_t end_ns;
+	int32_t cpu;
+};
+
+/* A worker was not running on a CPU while it was expected to */
+struct spike {
+	uint64_t from_ns;
+	uint64_t to_ns;
+	int32_t cpu;
+};
+
+/* A memory mapped binary events log */
+struct wlg_log {
+	int fd;
+	struct wlg_log_header *hdr;
+	struct wlg_log_event *events;
+	uint64_t count;
+	uint64_t capacity;
+	uint64_t start_ns;
+};
+
+/*
+ * PELT style load tracking of a worker, as estimated from its own sleeps
+ * and wakeups. Updated by the worker only, read by the load tracking
+ * thread, which relies on the sequence counter for a consistent snapshot.
+ */
+struct pelt {
+	uint32_t seq;
+#define PELT_SLEEPING 0
+#define PELT_RUNNABLE 1
+#define PELT_RUNNING  2
+	uint8_t state;
+	uint64_t last_ns;
+	/* Geometric series, normalized in [0..1024] */
+	double util;
+	double runnable;
+};
+
+/*
+ * Workers synchronized start support: workers are created once, and wait
+ * for the main thread on a barrier at the beginning and at the end of each
+ * phase of the test
+ */
+static pthread_barrier_t phase_barrier;
+static struct timespec phase_ts;
+
+/*
+ * Parameters of the INTERACTIVE, PERIODIC or YIELD workers from a phase on,
+ * i.e. the A,B pairs of their option, the last pair being used for the
+ * remaining workers. Workers are re-armed with them while parked.
+ */
+#define PHASE_SPECS_MAX 32
+struct phase_spec {
+	uint32_t phase;
+	uint8_t kind;
+	uint32_t pairs;
+	uint32_t *values;
+};
+static struct phase_spec phase_specs[PHASE_SPECS_MAX];
+static uint32_t phase_specs_count = 0;
 
 struct wdata {
 
@@ -102,8 +270,19 @@ struct wdata {
 #define WORKER_INTERACTIVE 1
 #define WORKER_PERIODC     2
 #define WORKER_YIELD       3
+#define WORKER_FOOTPRINT   4
+#define WORKER_MISPREDICT  5
+#define WORKER_CONTENTION  6
+#define WORKER_HANDOFF     7
+#define WORKER_GRAPH       8
+#define WORKER_AUDIO       9
+#define WORKER_THREAD     10
+#define WORKER_EXEC       11
 	uint8_t kind;
 
+	/* CPU the worker is pinned to (-1: not pinned) */
+	int16_t cpu;
+
 	/* Worker params */
 	union {
 		struct {
@@ -118,12 +297,131 @@ struct wdata {
 			uint32_t period;
 			uint32_t interval;
 		} yield;
+		struct {
+			uint32_t mask;
+			uint32_t state;
+		} footprint;
+		struct {
+			uint8_t *data;
+			uint16_t threshold;
+		} mispredict;
+		struct {
+			uint64_t *counter;
+#define CONTENTION_OP_ADD    0
+#define CONTENTION_OP_CAS    1
+#define CONTENTION_OP_STORE  2
+			uint8_t op;
+		} contention;
+		struct {
+			struct handoff *pair;
+			uint8_t producer;
+		} handoff;
+		struct {
+			struct dag *dag;
+			uint8_t node;
+		} graph;
+		struct {
+			struct audio *path;
+			uint8_t producer;
+		} audio;
+		struct {
+			struct churn *churn;
+		} thread;
+		struct {
+			struct storm *storm;
+		} exec;
 	} params;
 
-};
+	/* Private (and lock-free) random numbers generator state */
+	uint32_t rnd;
+
+	/* Empirical distributions of the durations parameters (NULL: none) */
+	struct dist *dist[2];
+
+	/* Activations schedule to replay (NULL: none) */
+	struct schedule *sched;
+
+	/* Worker statistics, within the measurement window */
+	uint64_t loops;
+	uint64_t run_ns;
+	uint64_t win_start_ns;
+	uint64_t win_loops;
+	uint64_t win_cpu_ns;
+
+	/* Wakeup latency distribution */
+	struct sketch *lat;
+
+	/* Sleep mechanism (index in sleeps), its file descriptor or futex,
+	 * and the distribution of the time slept past the deadlines */
+	uint8_t sleep;
+	int sleep_fd;
+	uint32_t sleep_futex;
+	struct sketch *oversleep;
+
+	/* Time spun before the deadlines, up to the spin margin, and time
+	 * spent running bursts, i.e. doing useful work */
+	uint64_t spin_margin_ns;
+	uint64_t spin_ns;
+	uint64_t work_ns;
+
+	/* Open-loop requests: next arrival, response times distribution and
+	 * requests arrived but not served by the end of the test */
+	uint64_t arrival_ns;
+	struct sketch *resp;
+	uint64_t backlog;
+
+	/* CPU occupancy timeline (ring buffer) and latency spikes */
+	struct occupancy *occ;
+	uint32_t occ_next;
+	uint8_t occ_wrapped;
+	struct occupancy occ_cur;
+	uint64_t occ_last_ns;
+	uint64_t occ_last_cpu_ns;
+	struct spike *spikes;
+	uint32_t spikes_count;
+
+	/* Binary events log */
+	struct wlg_log log;
+
+	/* Capacity invariant bursts statistics, by CPU */
+	struct burst_stats *bursts;
+
+	/* Estimated load tracking signals */
+	struct pelt pelt;
+
+	/* Data hand-off statistics, by placement of the two workers */
+	uint64_t handoff_count[4];
+	uint64_t handoff_ns[4];
+
+/* Workers update their statistics while running, thus each one of them is
+ * kept on its own cache lines to not slow down its neighbours */
+} __attribute__((aligned(CACHELINE_SIZE)));
 
 static char *worker_kind[] = {
-	"Batch", "Interactive", "Periodic", "Yield" };
+	"Batch", "Interactive", "Periodic", "Yield",
+	"Footprint", "Mispredict", "Contention", "Handoff", "Graph", "Audio",
+	"Thread", "Exec" };
+
+/* What a worker loop accounts for, by worker kind */
+static char *worker_unit[] = {
+	"loops", "activations", "activations", "bursts",
+	"calls", "branches", "ops", "transfers", "frames", "buffers",
+	"threads", "processes" };
+
+static uint32_t workers_count = 0;
+
+/* Duty-cycle of the probe worker, light enough not to perturb the others */
+#define PROBE_DUTY_CYCLE 5
+
+/* The probe is a PERIODIC worker, not accounted with the other ones */
+static inline int
+worker_probe(struct wdata *wdata)
+{
+	return wdata->kind == WORKER_PERIODC && !wdata->id;
+}
+
+static struct wdata *workers_data;
+static pthread_t *workers;
 
 
 static void
@@ -255,285 +553,4095 @@ int timespec_milliseconds(struct timespec *a)
 	return a->tv_sec * S_TO_MS + a->tv_nsec / MS_TO_NS;
 }
 
-void timespec_print(struct timespec *a)
+// convert the timespec into nanoseconds
+uint64_t timespec_nanoseconds(struct timespec *a)
 {
-	printf("%li.%09li\n", a->tv_sec, a->tv_nsec);
+	return (uint64_t)a->tv_sec * S_TO_NS + a->tv_nsec;
 }
 
+uint64_t timespec_now_ns(void)
+{
+	struct timespec now_ts;
 
-////////////////////////////////////////////////////////////////////////////////
-// Workers definition
-////////////////////////////////////////////////////////////////////////////////
+	clock_gettime(CLOCK_MONOTONIC_RAW, &now_ts);
+	return timespec_nanoseconds(&now_ts);
+}
 
-/* Block until we're ready to go */
-static void
-sync_start(struct wdata *wdata)
+// CPU time of the calling thread
+uint64_t timespec_thread_ns(void)
 {
-	/* Wait start conditon */
-	pthread_mutex_lock(&start_mtx);
-	pthread_cond_wait(&start_cv, &start_mtx);
-	pthread_mutex_unlock(&start_mtx);
+	struct timespec cpu_ts;
 
-	DB(printf(WD("started\n")));
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_ts);
+	return timespec_nanoseconds(&cpu_ts);
 }
 
+/* Samples are accounted only within the measurement window, which excludes
+ * the configured warmup and cooldown times */
+static inline int
+measuring(uint64_t now_ns)
+{
+	return now_ns >= meas_start_ns && now_ns < meas_end_ns;
+}
 
-static void
-busy_loop(void)
+void timespec_print(struct timespec *a)
 {
-	volatile uint16_t i = 1;
-	for ( ; i ; ++i);
+	printf("%li.%09li\n", a->tv_sec, a->tv_nsec);
 }
 
-static inline uint32_t
-normal_random(uint32_t max_value)
+
+////////////////////////////////////////////////////////////////////////////////
+// Binary events log
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Each worker appends its events to its own memory mapped file, thus logging
+ * an event costs just a few stores. The file is grown (and remapped) by
+ * LOG_CHUNK records at a time, and truncated to the actual number of records
+ * when the worker terminates.
+ */
+#define LOG_CHUNK 65536
+
+static size_t
+log_size(uint64_t capacity)
 {
-	double value = max_value;
-	value *= random();
-	value /= RAND_MAX;
-	return value;
+	return sizeof(struct wlg_log_header)
+		+ capacity * sizeof(struct wlg_log_event);
 }
 
 static void
-worker_batch(struct wdata *wdata)
+log_open(struct wdata *wdata)
 {
-	/* Dummy busy loop */
-	//DB(printf("%s loop\n", wdata->name));
-	busy_loop();
+	struct wlg_log *log = &wdata->log;
+	char path[PATH_MAX];
+	void *map;
+
+	log->fd = -1;
+	if (!conf_log_dir)
+		return;
+
+	snprintf(path, sizeof(path), "%s/%s.evt", conf_log_dir, wdata->name);
+	log->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (log->fd < 0)
+		barf("log open:");
+
+	log->capacity = LOG_CHUNK;
+	if (ftruncate(log->fd, log_size(log->capacity)))
+		barf("log ftruncate:");
+	map = mmap(NULL, log_size(log->capacity), PROT_READ | PROT_WRITE,
+			MAP_SHARED, log->fd, 0);
+	if (map == MAP_FAILED)
+		barf("log mmap:");
+
+	log->hdr = map;
+	log->events = (struct wlg_log_event *)(log->hdr + 1);
+	log->count = 0;
+
+	memcpy(log->hdr->magic, WLG_LOG_MAGIC, sizeof(log->hdr->magic));
+	log->hdr->version = WLG_LOG_VERSION;
+	log->hdr->header_size = sizeof(struct wlg_log_header);
+	log->hdr->record_size = sizeof(struct wlg_log_event);
+	log->hdr->tid = wdata->pid;
+	log->hdr->id = wdata->id;
+	log->hdr->kind = wdata->kind;
+	strncpy(log->hdr->name, wdata->name, sizeof(log->hdr->name) - 1);
+	log->hdr->count = 0;
 }
 
+/* Set the time reference, once the test has started */
 static void
-worker_interactive(struct wdata *wdata)
+log_start(struct wdata *wdata)
 {
-	uint32_t delay, process;
-	struct timespec end_ts, now_ts;
+	struct wlg_log *log = &wdata->log;
 
-	/* Here we just need fast even if not reporducible and/or "safe"
-	 * random numbers. We just need to introduce some variation on
-	 * timings */
+	if (log->fd < 0)
+		return;
 
-	/* Setup next interrupt (uniform distribution) */
-	delay = normal_random(wdata->params.interrupt.interval_max);
-	DB(printf(WD("sleeping for %9d [us]\n"), delay));
-	usleep(delay);
+	log->start_ns = timespec_nanoseconds(&start_ts);
+	log->hdr->start_ns = log->start_ns;
+}
 
-	/* Setup processing time (unifor distribution) */
-	process = normal_random(wdata->params.interrupt.duration_max);
-	DB(printf(WD("process  for %9d [us]\n"), process));
+static void
+log_grow(struct wlg_log *log)
+{
+	uint64_t capacity = log->capacity + LOG_CHUNK;
+	void *map;
+
+	if (ftruncate(log->fd, log_size(capacity)))
+		barf("log ftruncate:");
+	map = mremap(log->hdr, log_size(log->capacity), log_size(capacity),
+			MREMAP_MAYMOVE);
+	if (map == MAP_FAILED)
+		barf("log mremap:");
+
+	log->hdr = map;
+	log->events = (struct wlg_log_event *)(log->hdr + 1);
+	log->capacity = capacity;
+}
 
-	/* Configure processing end */
-	clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
-	timespec_add_us(&end_ts, process);
+static inline void
+log_event(struct wdata *wdata, uint64_t now_ns, uint8_t type, uint64_t arg)
+{
+	struct wlg_log *log = &wdata->log;
+	struct wlg_log_event *event;
 
-	//printf("End processing @ ");
-	//timespec_print(&end_ts);
+	if (log->fd < 0)
+		return;
 
-	while (1) {
-		clock_gettime(CLOCK_MONOTONIC_RAW, &now_ts);
-		//printf("Now processing @ ");
-		//timespec_print(&now_ts);
-		if (timespec_older(&now_ts , &end_ts))
-			break;
-		busy_loop();
-	}
+	if (log->count == log->capacity)
+		log_grow(log);
 
+	event = log->events + log->count++;
+	event->ts_ns = now_ns - log->start_ns;
+	event->arg = (arg > UINT32_MAX) ? UINT32_MAX : arg;
+	event->cpu = sched_getcpu();
+	event->type = type;
 }
 
 static void
-worker_periodic(struct wdata *wdata)
+log_close(struct wdata *wdata)
 {
-	uint32_t sleep, process;
-	struct timespec end_ts, now_ts;
-
-	/* Setup next interrupt (uniform distribution) */
-	process = ( (float) wdata->params.period.duration *
-		  ( (float) wdata->params.period.duty_cycle / 100.0) );
-	sleep   = wdata->params.period.duration - process;
+	struct wlg_log *log = &wdata->log;
 
-	DB(printf(WD("sleeping for %9d [us]\n"), sleep));
-	usleep(sleep);
+	if (log->fd < 0)
+		return;
 
-	DB(printf(WD("process  for %9d [us]\n"), process));
+	log->hdr->count = log->count;
+	munmap(log->hdr, log_size(log->capacity));
+	if (ftruncate(log->fd, log_size(log->count)))
+		barf("log ftruncate:");
+	close(log->fd);
+	log->fd = -1;
+}
 
-	/* Configure processing end */
-	clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
-	timespec_add_us(&end_ts, process);
 
-	//printf("End processing @ ");
-	//timespec_print(&end_ts);
+////////////////////////////////////////////////////////////////////////////////
+// Platform topology
+////////////////////////////////////////////////////////////////////////////////
 
-	while (1) {
-		clock_gettime(CLOCK_MONOTONIC_RAW, &now_ts);
-		//printf("Now processing @ ");
-		//timespec_print(&now_ts);
-		if (timespec_older(&now_ts , &end_ts))
-			break;
-		busy_loop();
-	}
-}
+#define SYSFS_CPU "/sys/devices/system/cpu"
 
-static void
-worker_yield(struct wdata *wdata)
+/* Read the first integer value of a (sysfs) file, return 0 on success */
+static int
+sysfs_read_int(const char *path, long *value)
 {
-	uint32_t period   = wdata->params.yield.period;
-	uint32_t interval = wdata->params.yield.interval;
-	struct timespec now_ts, end_ts, yield_ts;
+	FILE *fp;
+	int ret;
 
-	/* Configure processing end */
-	clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
-	timespec_add_us(&end_ts, period);
+	fp = fopen(path, "r");
+	if (!fp)
+		return -1;
+	ret = fscanf(fp, "%ld", value);
+	fclose(fp);
 
-	// Burst period
-	DB(printf(WD("burst  for %9d [us]\n"), period));
-	while (1) {
-		clock_gettime(CLOCK_MONOTONIC_RAW, &now_ts);
-		//printf("Now processing @ ");
-		//timespec_print(&now_ts);
-		if (timespec_older(&now_ts , &end_ts))
-			break;
-		busy_loop();
-	}
+	return (ret == 1) ? 0 : -1;
+}
 
-	/* Configure yield end */
-	clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
-	timespec_add_us(&end_ts, period);
+struct cpu_topology {
+	long online;
+	long core_id;
+	long package_id;
+	long cluster_id;
+	/* Capacity as reported by the kernel (-1: not available) */
+	long sysfs_capacity;
+	/* Calibrated reference loops per second (0: not calibrated) */
+	double loops_per_s;
+	/* Calibrated capacity, relative to the fastest CPU in [0..1024] */
+	long capacity;
+};
 
-	/* Configure next yield time */
-	clock_gettime(CLOCK_MONOTONIC_RAW, &yield_ts);
-	DB(printf(WD("Sum first yield to @ ")));
-	DB(timespec_print(&yield_ts));
-	timespec_add_us(&yield_ts, interval);
+static struct cpu_topology *cpus_topology;
+static int cpus_count = 0;
 
-	// Yield period
-	DB(printf(WD("yield  for %9d [us]\n"), period));
-	DB(printf(WD("next yield @ ")));
-	DB(timespec_print(&yield_ts));
-	while (1) {
-		clock_gettime(CLOCK_MONOTONIC_RAW, &now_ts);
-		DB(printf(WD("Now processing @ ")));
-		DB(timespec_print(&now_ts));
-		if (timespec_older(&now_ts , &end_ts))
-			break;
-		// Yield if an interval has passed
-		if (timespec_older(&now_ts , &yield_ts)) {
-			timespec_add_us(&yield_ts, interval);
-			DB(printf(WD("YIELD, next yield @")));
-			DB(timespec_print(&yield_ts));
-			pthread_yield();
-		}
+/* Load topology information of all the (possible) CPUs.
+ * Missing attributes are tolerated: a CPU without the cluster_id attribute
+ * (which is recent) is considered part of its package cluster, as it was
+ * reported by previous ARM kernels. */
+static void
+topology_setup(void)
+{
+	char path[128];
+	int cpu;
+
+	cpus_count = sysconf(_SC_NPROCESSORS_CONF);
+	if (cpus_count < 1)
+		cpus_count = 1;
+
+	cpus_topology = calloc(cpus_count, sizeof(struct cpu_topology));
+	if (!cpus_topology)
+		barf("calloc:");
+
+	for (cpu = 0; cpu < cpus_count; ++cpu) {
+		/* CPUs which cannot be hotplugged do not have this attribute */
+		snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/online", cpu);
+		if (sysfs_read_int(path, &cpus_topology[cpu].online))
+			cpus_topology[cpu].online = 1;
+		snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/cpu_capacity", cpu);
+		if (sysfs_read_int(path, &cpus_topology[cpu].sysfs_capacity))
+			cpus_topology[cpu].sysfs_capacity = -1;
+		snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/topology/core_id", cpu);
+		if (sysfs_read_int(path, &cpus_topology[cpu].core_id))
+			cpus_topology[cpu].core_id = cpu;
+		snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/topology/physical_package_id", cpu);
+		if (sysfs_read_int(path, &cpus_topology[cpu].package_id))
+			cpus_topology[cpu].package_id = 0;
+		snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/topology/cluster_id", cpu);
+		if (sysfs_read_int(path, &cpus_topology[cpu].cluster_id))
+			cpus_topology[cpu].cluster_id = cpus_topology[cpu].package_id;
 	}
 }
 
-static void *
-worker(void *conf)
-{
-	struct wdata *wdata = (struct wdata*) conf;
-	struct timespec now_ts;
-	struct timespec end_ts;
+#define PLACEMENT_SAME_CPU 0
+#define PLACEMENT_SMT      1
+#define PLACEMENT_CLUSTER  2
+#define PLACEMENT_REMOTE   3
 
-	/* Setup random number generator */
-	wdata->pid = gettid();
-	srandom(wdata->pid);
+static char *placement_name[] = {
+	"same CPU", "SMT sibling", "same cluster", "other cluster" };
 
-	/* Setup worker name */
-	snprintf(wdata->name, sizeof(wdata->name), "wlg_%c%03d",
-		worker_kind[wdata->kind][0], wdata->id);
-	prctl(PR_SET_NAME, wdata->name, NULL, NULL, NULL);
-	DB(printf(WD("worker created\n")));
+/* Return how close to each other two CPUs are */
+static uint8_t
+topology_placement(int a, int b)
+{
+	struct cpu_topology *ta, *tb;
+
+	if (a == b)
+		return PLACEMENT_SAME_CPU;
+	if (a < 0 || b < 0 || a >= cpus_count || b >= cpus_count)
+		return PLACEMENT_REMOTE;
+
+	ta = cpus_topology + a;
+	tb = cpus_topology + b;
+	/* core_id is numbered per cluster, e.g. on arm64 device-tree systems */
+	if (ta->package_id != tb->package_id ||
+			ta->cluster_id != tb->cluster_id)
+		return PLACEMENT_REMOTE;
+	if (ta->core_id == tb->core_id)
+		return PLACEMENT_SMT;
+
+	return PLACEMENT_CLUSTER;
+}
 
-	sync_start(wdata);
 
-	/* Setup worker termination time */
-	clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
-	end_ts.tv_sec += conf_td;
+////////////////////////////////////////////////////////////////////////////////
+// Platform sampling
+////////////////////////////////////////////////////////////////////////////////
 
-	while (1) {
+/* Distinct frequencies tracked per CPU, i.e. OPPs */
+#define FREQ_BINS 32
+/* Same as the kernel CPUIDLE_STATE_MAX */
+#define IDLE_STATES_MAX 10
 
-		/* Check end of test */
-		clock_gettime(CLOCK_MONOTONIC_RAW, &now_ts);
-		if (timespec_older(&now_ts, &end_ts))
-			break;
+struct freq_bin {
+	long khz;
+	uint64_t samples;
+};
 
-		/* Do workload */
-		switch (wdata->kind) {
-		case WORKER_BATCH:
-			worker_batch(wdata);
-			break;
-		case WORKER_INTERACTIVE:
-			worker_interactive(wdata);
-			break;
-		case WORKER_PERIODC:
-			worker_periodic(wdata);
-			break;
-		case WORKER_YIELD:
-			worker_yield(wdata);
-			break;
-		}
+/* Counters of an idle state at the begin [0] and end [1] of the window */
+struct idle_state {
+	char name[16];
+	uint64_t usage[2];
+	uint64_t time_us[2];
+};
 
-	}
+struct cpu_sampling {
+	/* Current frequency attribute (-1: not available) */
+	int freq_fd;
+	/* Frequency cap attribute (-1: not available) */
+	int max_fd;
+	/* Frequency cap before the test started [kHz] */
+	long max_khz;
+	/* Thermal throttling events, e.g. on x86 (-1: not available) */
+	int64_t throttle_count;
+	uint64_t samples;
+	uint32_t freqs_count;
+	struct freq_bin freqs[FREQ_BINS];
+	uint32_t idle_count;
+	struct idle_state idle[IDLE_STATES_MAX];
+	/* Busy time at the begin [0] and end [1] of the window [ticks] */
+	uint64_t busy_ticks[2];
+};
 
-	DB(printf(WD("terminated\n")));
+static struct cpu_sampling *cpus_sampling = NULL;
+static uint64_t idle_snapshot_ns[2];
+static pthread_t sampler;
+static struct wdata sampler_data;
+/* Serializes the sampler with the phases begin and end in the main thread */
+static pthread_mutex_t sampler_mtx = PTHREAD_MUTEX_INITIALIZER;
+/* Measurement window of the current phase: 0 not started, 1 open, 2 closed */
+static int sampler_window = 0;
+static volatile int sampler_stop = 0;
+
+#define THERMAL_ZONES_MAX 16
+#define SYSFS_THERMAL "/sys/class/thermal"
+
+struct thermal_zone {
+	char type[20];
+	int temp_fd;
+	/* Temperatures over the measurement window [m°C] */
+	long min, max;
+	double sum;
+	uint64_t samples;
+};
 
-	return NULL;
-}
+static struct thermal_zone thermal_zones[THERMAL_ZONES_MAX];
+static uint32_t thermal_zones_count = 0;
 
-////////////////////////////////////////////////////////////////////////////////
-// Setup workload
-////////////////////////////////////////////////////////////////////////////////
+/* Intervals in which CPUs have been throttled */
+#define THROTTLE_INTERVALS_MAX 64
 
-static char *opts = "b:d:hi:p:y:";
-static struct option long_options[] =
-{
-	{"batch",    required_argument, 0, 'b'},
-	{"duration", required_argument, 0, 'd'},
-	{"help",     no_argument,       0, 'h'},
-	{"intrrupt", required_argument, 0, 'i'},
-	{"process",  required_argument, 0, 'p'},
-	{"verbose",  no_argument,       &conf_vr, 1},
-	{"yield",    required_argument, 0, 'y'},
-	{0, 0, 0, 0}
+struct throttle_interval {
+	uint64_t start_ns;
+	uint64_t end_ns;
+	/* Lowest frequency cap within the interval (0: unknown) [kHz] */
+	long cap_khz;
 };
 
-static void
-print_usage(char *prog)
+static struct throttle_interval throttle_intervals[THROTTLE_INTERVALS_MAX];
+static uint32_t throttle_count = 0;
+static uint64_t throttle_ns = 0;
+static struct throttle_interval throttle_current;
+
+/* Read the first unsigned value of a (sysfs) file, return 0 on success */
+static int
+sysfs_read_u64(const char *path, uint64_t *value)
 {
-	fprintf(stderr, " \n");
-	fprintf(stderr, "Usage: %s <options> <workload>\n", prog);
-	fprintf(stderr, " \n");
-	fprintf(stderr, " <options>:\n");
-	fprintf(stderr, "   -d, --duration - test duration in [s] (default: 5)\n");
-	fprintf(stderr, "   --verbose      - enable verbose output\n");
-	fprintf(stderr, " \n");
-	fprintf(stderr, " <workload>:\n");
-	fprintf(stderr, "   -b N - spawn N BATCH threads\n");
-	fprintf(stderr, "   -i N,[<I,D>] - spawn N INTERACTIVE tasks with the specified execution model:\n");
-	fprintf(stderr, "            start (at least) once every I [us]\n");
-	fprintf(stderr, "            run for up to D [us]\n");
-	fprintf(stderr, "     I and D are upper bounds for normally distributed actual values\n");
-	fprintf(stderr, "   -p N,[<P,D>] - spawn N PERIODC tasks with the specified execution model:\n");
-	fprintf(stderr, "            period duration of P [us]\n");
-	fprintf(stderr, "            running duty-cycle of D [us]\n");
-	fprintf(stderr, "   -y N,[<P,I>] - spawn N YIELD tasks with the specified execution model:\n");
-	fprintf(stderr, "            burst/yield period duration of P [us]\n");
-	fprintf(stderr, "            yielding interval of I [us] (during the yield period)\n");
-	fprintf(stderr, " \n");
+	unsigned long long v;
+	FILE *fp;
+	int ret;
+
+	fp = fopen(path, "r");
+	if (!fp)
+		return -1;
+	ret = fscanf(fp, "%llu", &v);
+	fclose(fp);
+	if (ret != 1)
+		return -1;
+
+	*value = v;
+	return 0;
 }
 
-static void
-parse_cmdline(int argc, char *argv[])
+/* Read a (sysfs) attribute kept open, return -1 on errors */
+static long
+sysfs_pread_int(int fd)
 {
-	int option_index = 0;
-	int c;
+	char buff[32];
+	ssize_t len;
 
-	while (1) {
+	len = pread(fd, buff, sizeof(buff) - 1, 0);
+	if (len <= 0)
+		return -1;
+	buff[len] = '\0';
 
-		c = getopt_long (argc, argv, opts,
-			long_options, &option_index);
+	return atol(buff);
+}
 
-		if (c == -1)
-			break;
+/* Sum of core and package thermal throttling events of a CPU */
+static int64_t
+sampling_throttle_count(int cpu)
+{
+	uint64_t core, package = 0;
+	char path[128];
+
+	snprintf(path, sizeof(path),
+		SYSFS_CPU "/cpu%d/thermal_throttle/core_throttle_count", cpu);
+	if (sysfs_read_u64(path, &core))
+		return -1;
+	snprintf(path, sizeof(path),
+		SYSFS_CPU "/cpu%d/thermal_throttle/package_throttle_count", cpu);
+	sysfs_read_u64(path, &package);
+
+	return core + package;
+}
+
+static void
+thermal_setup(void)
+{
+	struct thermal_zone *tz;
+	char path[128];
+	FILE *fp;
+	uint32_t zone;
+
+	for (zone = 0; thermal_zones_count < THERMAL_ZONES_MAX; ++zone) {
+		tz = thermal_zones + thermal_zones_count;
+		snprintf(path, sizeof(path),
+			SYSFS_THERMAL "/thermal_zone%u/temp", zone);
+		tz->temp_fd = open(path, O_RDONLY);
+		if (tz->temp_fd < 0)
+			break;
+
+		snprintf(path, sizeof(path),
+			SYSFS_THERMAL "/thermal_zone%u/type", zone);
+		strcpy(tz->type, "?");
+		fp = fopen(path, "r");
+		if (fp) {
+			if (!fgets(tz->type, sizeof(tz->type), fp))
+				strcpy(tz->type, "?");
+			tz->type[strcspn(tz->type, "\n")] = '\0';
+			fclose(fp);
+		}
+		tz->min = LONG_MAX;
+		tz->max = LONG_MIN;
+		++thermal_zones_count;
+	}
+}
+
+static void
+sampling_setup(void)
+{
+	struct cpu_sampling *cs;
+	char path[128];
+	FILE *fp;
+	int cpu;
+
+	cpus_sampling = calloc(cpus_count, sizeof(struct cpu_sampling));
+	if (!cpus_sampling)
+		barf("calloc:");
+
+	for (cpu = 0; cpu < cpus_count; ++cpu) {
+		cs = cpus_sampling + cpu;
+
+		snprintf(path, sizeof(path),
+			SYSFS_CPU "/cpu%d/cpufreq/scaling_cur_freq", cpu);
+		cs->freq_fd = open(path, O_RDONLY);
+		snprintf(path, sizeof(path),
+			SYSFS_CPU "/cpu%d/cpufreq/scaling_max_freq", cpu);
+		cs->max_fd = open(path, O_RDONLY);
+		cs->max_khz = (cs->max_fd >= 0) ? sysfs_pread_int(cs->max_fd) : -1;
+		cs->throttle_count = sampling_throttle_count(cpu);
+
+		for ( ; cs->idle_count < IDLE_STATES_MAX; ++cs->idle_count) {
+			snprintf(path, sizeof(path),
+				SYSFS_CPU "/cpu%d/cpuidle/state%u/name",
+				cpu, cs->idle_count);
+			fp = fopen(path, "r");
+			if (!fp)
+				break;
+			if (!fgets(cs->idle[cs->idle_count].name,
+					sizeof(cs->idle[0].name), fp))
+				strcpy(cs->idle[cs->idle_count].name, "?");
+			cs->idle[cs->idle_count].name[
+				strcspn(cs->idle[cs->idle_count].name, "\n")] = '\0';
+			fclose(fp);
+		}
+	}
+
+	thermal_setup();
+}
+
+/* Read CPUs busy time from /proc/stat */
+static void
+sampling_busy(int end)
+{
+	unsigned long long user, nice, sys, idle, iowait, irq, softirq, steal;
+	char line[256];
+	FILE *fp;
+	int cpu;
+
+	fp = fopen("/proc/stat", "r");
+	if (!fp)
+		return;
+	while (fgets(line, sizeof(line), fp)) {
+		steal = 0;
+		if (sscanf(line, "cpu%d %llu %llu %llu %llu %llu %llu %llu %llu",
+				&cpu, &user, &nice, &sys, &idle, &iowait,
+				&irq, &softirq, &steal) < 8)
+			continue;
+		if (cpu < 0 || cpu >= cpus_count)
+			continue;
+		cpus_sampling[cpu].busy_ticks[end] =
+			user + nice + sys + irq + softirq + steal;
+	}
+	fclose(fp);
+}
+
+/* Snapshot idle states counters, at the begin (0) or end (1) of the window */
+static void
+sampling_snapshot(int end)
+{
+	struct idle_state *is;
+	char path[128];
+	uint32_t state;
+	int cpu;
+
+	idle_snapshot_ns[end] = timespec_now_ns();
+	sampling_busy(end);
+	for (cpu = 0; cpu < cpus_count; ++cpu) {
+		for (state = 0; state < cpus_sampling[cpu].idle_count; ++state) {
+			is = cpus_sampling[cpu].idle + state;
+			snprintf(path, sizeof(path),
+				SYSFS_CPU "/cpu%d/cpuidle/state%u/usage", cpu, state);
+			sysfs_read_u64(path, &is->usage[end]);
+			snprintf(path, sizeof(path),
+				SYSFS_CPU "/cpu%d/cpuidle/state%u/time", cpu, state);
+			sysfs_read_u64(path, &is->time_us[end]);
+		}
+	}
+}
+
+static void
+sampling_freq(struct cpu_sampling *cs)
+{
+	uint32_t i, nearest;
+	long khz;
+
+	khz = sysfs_pread_int(cs->freq_fd);
+	if (khz < 0)
+		return;
+
+	for (i = 0, nearest = 0; i < cs->freqs_count; ++i) {
+		if (cs->freqs[i].khz == khz)
+			break;
+		if (labs(cs->freqs[i].khz - khz) <
+				labs(cs->freqs[nearest].khz - khz))
+			nearest = i;
+	}
+	if (i == cs->freqs_count) {
+		/* Too many frequencies, account to the nearest one */
+		if (cs->freqs_count == FREQ_BINS)
+			i = nearest;
+		else
+			cs->freqs[cs->freqs_count++].khz = khz;
+	}
+
+	++cs->freqs[i].samples;
+	++cs->samples;
+}
+
+static void
+thermal_sample(void)
+{
+	struct thermal_zone *tz;
+	uint32_t zone;
+	long temp;
+
+	for (zone = 0; zone < thermal_zones_count; ++zone) {
+		tz = thermal_zones + zone;
+		temp = sysfs_pread_int(tz->temp_fd);
+		if (temp == -1)
+			continue;
+		if (temp < tz->min)
+			tz->min = temp;
+		if (temp > tz->max)
+			tz->max = temp;
+		tz->sum += temp;
+		++tz->samples;
+	}
+}
+
+static void
+throttle_end(uint64_t now_ns)
+{
+	struct throttle_interval *ti = &throttle_current;
+
+	ti->end_ns = now_ns;
+	throttle_ns += ti->end_ns - ti->start_ns;
+	log_event(&sampler_data, now_ns, WLG_EV_THROTTLE_END,
+			ti->end_ns - ti->start_ns);
+	if (throttle_count < THROTTLE_INTERVALS_MAX)
+		throttle_intervals[throttle_count] = *ti;
+	++throttle_count;
+	ti->start_ns = 0;
+}
+
+/*
+ * CPUs are throttled when their frequency is capped below what it was at
+ * the begin of the test, or the kernel reports new thermal throttling events.
+ * These events happened since the previous sample, taken at prev_ns.
+ */
+static void
+throttle_sample(uint64_t prev_ns, uint64_t now_ns)
+{
+	struct throttle_interval *ti = &throttle_current;
+	struct cpu_sampling *cs;
+	long cap_khz = 0, khz;
+	int64_t count;
+	int throttled = 0, events = 0;
+	int cpu;
+
+	for (cpu = 0; cpu < cpus_count; ++cpu) {
+		cs = cpus_sampling + cpu;
+		if (cs->max_fd >= 0) {
+			khz = sysfs_pread_int(cs->max_fd);
+			if (khz > 0 && khz < cs->max_khz) {
+				throttled = 1;
+				if (!cap_khz || khz < cap_khz)
+					cap_khz = khz;
+			}
+		}
+		if (cs->throttle_count >= 0) {
+			count = sampling_throttle_count(cpu);
+			if (count > cs->throttle_count) {
+				throttled = events = 1;
+				cs->throttle_count = count;
+			}
+		}
+	}
+
+	if (throttled && !ti->start_ns) {
+		ti->start_ns = (events && prev_ns) ? prev_ns : now_ns;
+		ti->cap_khz = cap_khz;
+		log_event(&sampler_data, ti->start_ns, WLG_EV_THROTTLE_START,
+				cap_khz);
+	} else if (throttled) {
+		if (cap_khz && (!ti->cap_khz || cap_khz < ti->cap_khz))
+			ti->cap_khz = cap_khz;
+	} else if (ti->start_ns) {
+		throttle_end(now_ns);
+	}
+}
+
+/* Close the measurement window of a phase, with the sampler lock held */
+static void
+sampling_window_close(void)
+{
+	if (sampler_window == 2)
+		return;
+	if (!sampler_window)
+		sampling_snapshot(0);
+	sampling_snapshot(1);
+	if (throttle_current.start_ns)
+		throttle_end(idle_snapshot_ns[1]);
+	sampler_window = 2;
+}
+
+/*
+ * Sample CPUs frequencies and throttling over the measurement window of
+ * each phase, till the main thread stops the sampler after the last one
+ */
+static void *
+sampler_thread(void *arg)
+{
+	struct timespec next_ts;
+	uint64_t now_ns, prev_ns = 0;
+	int cpu, err;
+
+	(void)arg;
+
+	/* Keep out of the way of the workers as much as possible */
+	setpriority(PRIO_PROCESS, gettid(), 19);
+
+	sampler_data.pid = gettid();
+	log_open(&sampler_data);
+	log_start(&sampler_data);
+
+	/* Timers do not support CLOCK_MONOTONIC_RAW */
+	clock_gettime(CLOCK_MONOTONIC, &next_ts);
+	while (!sampler_stop) {
+		timespec_add_us(&next_ts, conf_sample_ms * 1000);
+		while ((err = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+				&next_ts, NULL)) == EINTR)
+			;
+		if (err) {
+			errno = err;
+			barf("clock_nanosleep:");
+		}
+
+		pthread_mutex_lock(&sampler_mtx);
+		now_ns = timespec_now_ns();
+		if (now_ns < meas_start_ns || sampler_window == 2) {
+			pthread_mutex_unlock(&sampler_mtx);
+			continue;
+		}
+		if (now_ns >= meas_end_ns) {
+			sampling_window_close();
+			pthread_mutex_unlock(&sampler_mtx);
+			continue;
+		}
+		if (!sampler_window) {
+			sampling_snapshot(0);
+			sampler_window = 1;
+			prev_ns = 0;
+		}
+
+		for (cpu = 0; cpu < cpus_count; ++cpu)
+			if (cpus_sampling[cpu].freq_fd >= 0)
+				sampling_freq(cpus_sampling + cpu);
+		thermal_sample();
+		throttle_sample(prev_ns, now_ns);
+		prev_ns = now_ns;
+		pthread_mutex_unlock(&sampler_mtx);
+	}
+
+	log_close(&sampler_data);
+
+	return NULL;
+}
+
+static void
+sampling_start(void)
+{
+	if (!conf_sample_ms)
+		return;
+
+	sampling_setup();
+	strcpy(sampler_data.name, "wlg_smpl");
+	sampler_data.kind = WLG_LOG_KIND_SAMPLER;
+	sampler_data.cpu = -1;
+	if (pthread_create(&sampler, NULL, sampler_thread, NULL))
+		barf("pthread_create:");
+}
+
+/* End of a phase: close its window, if the sampler has not done it yet */
+static void
+sampling_phase_end(void)
+{
+	if (!conf_sample_ms)
+		return;
+
+	pthread_mutex_lock(&sampler_mtx);
+	sampling_window_close();
+	pthread_mutex_unlock(&sampler_mtx);
+}
+
+/* Begin of a phase: reset the samples and the throttling of the previous one */
+static void
+sampling_phase_begin(void)
+{
+	struct cpu_sampling *cs;
+	struct thermal_zone *tz;
+	uint32_t i;
+	int cpu;
+
+	if (!conf_sample_ms)
+		return;
+
+	pthread_mutex_lock(&sampler_mtx);
+	for (cpu = 0; cpu < cpus_count; ++cpu) {
+		cs = cpus_sampling + cpu;
+		for (i = 0; i < cs->freqs_count; ++i)
+			cs->freqs[i].samples = 0;
+		cs->samples = 0;
+		if (cs->throttle_count >= 0)
+			cs->throttle_count = sampling_throttle_count(cpu);
+	}
+	for (i = 0; i < thermal_zones_count; ++i) {
+		tz = thermal_zones + i;
+		tz->min = LONG_MAX;
+		tz->max = LONG_MIN;
+		tz->sum = 0;
+		tz->samples = 0;
+	}
+	throttle_count = 0;
+	throttle_ns = 0;
+	sampler_window = 0;
+	pthread_mutex_unlock(&sampler_mtx);
+}
+
+static void
+sampling_stop(void)
+{
+	uint32_t i;
+	int cpu;
+
+	if (!conf_sample_ms)
+		return;
+
+	sampler_stop = 1;
+	pthread_join(sampler, NULL);
+	for (cpu = 0; cpu < cpus_count; ++cpu) {
+		if (cpus_sampling[cpu].freq_fd >= 0)
+			close(cpus_sampling[cpu].freq_fd);
+		if (cpus_sampling[cpu].max_fd >= 0)
+			close(cpus_sampling[cpu].max_fd);
+	}
+	for (i = 0; i < thermal_zones_count; ++i)
+		close(thermal_zones[i].temp_fd);
+}
+
+/* Thermal zones temperatures and throttling intervals */
+static void
+report_thermal(void)
+{
+	struct throttle_interval *ti;
+	struct thermal_zone *tz;
+	uint64_t window_ns;
+	uint32_t i;
+
+	if (!conf_sample_ms)
+		return;
+
+	if (thermal_zones_count)
+		printf(FI("Thermal zones temperature:\n"));
+	for (i = 0; i < thermal_zones_count; ++i) {
+		tz = thermal_zones + i;
+		if (!tz->samples)
+			continue;
+		printf(FI("%-20s min %6.1f, avg %6.1f, max %6.1f [C]\n"),
+			tz->type, tz->min / 1000.0,
+			tz->sum / tz->samples / 1000.0, tz->max / 1000.0);
+	}
+
+	window_ns = idle_snapshot_ns[1] - idle_snapshot_ns[0];
+	if (!throttle_count) {
+		printf(FI("Throttling: none detected\n"));
+		return;
+	}
+	printf(FI("Throttling: %u intervals, %.3f [s] (%.1f%% of the window)\n"),
+		throttle_count, (double)throttle_ns / S_TO_NS,
+		window_ns ? 100.0 * throttle_ns / window_ns : 0);
+	for (i = 0; i < throttle_count && i < THROTTLE_INTERVALS_MAX; ++i) {
+		ti = throttle_intervals + i;
+		printf(FI("throttled [%9.3f, %9.3f] [s], cap %6ld [MHz] (0: unknown)\n"),
+			(double)(ti->start_ns - timespec_nanoseconds(&start_ts))
+				/ S_TO_NS,
+			(double)(ti->end_ns - timespec_nanoseconds(&start_ts))
+				/ S_TO_NS,
+			ti->cap_khz / 1000);
+	}
+	if (throttle_count > THROTTLE_INTERVALS_MAX)
+		printf(FI("(%u more intervals not shown)\n"),
+			throttle_count - THROTTLE_INTERVALS_MAX);
+}
+
+/* Per CPU frequencies distribution and idle states residency */
+static void
+report_sampling(void)
+{
+	struct cpu_sampling *cs;
+	struct idle_state *is;
+	double window_us, sum;
+	char line[512];
+	uint32_t i, reported = 0;
+	int cpu, len;
+
+	if (!conf_sample_ms)
+		return;
+
+	printf(FI("CPUs frequency residency:\n"));
+	for (cpu = 0; cpu < cpus_count; ++cpu) {
+		cs = cpus_sampling + cpu;
+		if (!cs->samples)
+			continue;
+		sum = 0;
+		len = 0;
+		for (i = 0; i < cs->freqs_count; ++i) {
+			sum += (double)cs->freqs[i].khz * cs->freqs[i].samples;
+			if (len < (int)sizeof(line))
+				len += snprintf(line + len, sizeof(line) - len,
+					" %ld:%.1f%%", cs->freqs[i].khz / 1000,
+					100.0 * cs->freqs[i].samples / cs->samples);
+		}
+		if (!len)
+			line[0] = '\0';
+		printf(FI("cpu%-3d avg %6.0f [MHz], [MHz]:residency%s\n"),
+			cpu, sum / cs->samples / 1000, line);
+		++reported;
+	}
+	if (!reported)
+		printf(FI("not available\n"));
+
+	window_us = (double)(idle_snapshot_ns[1] - idle_snapshot_ns[0])
+		/ US_TO_NS;
+	if (window_us <= 0)
+		return;
+
+	printf(FI("CPUs idle states residency:\n"));
+	for (cpu = 0, reported = 0; cpu < cpus_count; ++cpu) {
+		cs = cpus_sampling + cpu;
+		if (!cs->idle_count)
+			continue;
+		len = 0;
+		for (i = 0; i < cs->idle_count; ++i) {
+			is = cs->idle + i;
+			if (len < (int)sizeof(line))
+				len += snprintf(line + len, sizeof(line) - len,
+					" %s:%lu/%.1f%%", is->name,
+					(unsigned long)(is->usage[1] - is->usage[0]),
+					100.0 * (is->time_us[1] - is->time_us[0])
+						/ window_us);
+		}
+		printf(FI("cpu%-3d state:entries/residency%s\n"), cpu, line);
+		++reported;
+	}
+	if (!reported)
+		printf(FI("not available\n"));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Energy model
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Power model file
+ *
+ * Each line describes the power of a set of CPUs, usually a core type:
+ *   opp  CPUS KHZ MW    - power [mW] when busy at frequency KHZ [kHz]
+ *   idle CPUS STATE MW  - power [mW] when in the cpuidle state named STATE
+ * where CPUS is a list like "0-3,6". Empty lines and '#' comments are ignored.
+ */
+
+struct cpu_power {
+	uint32_t opps_count;
+	struct {
+		long khz;
+		double mw;
+	} opps[FREQ_BINS];
+	uint32_t idle_count;
+	struct {
+		char name[16];
+		double mw;
+	} idle[IDLE_STATES_MAX];
+};
+
+static struct cpu_power *cpus_power = NULL;
+static double energy_mj = -1;
+
+/* Mark the CPUs of a list like "0-3,6", return 0 on success */
+static int
+cpulist_parse(const char *list, uint8_t *cpus)
+{
+	char *end;
+	long first, last;
+
+	memset(cpus, 0, cpus_count);
+	for (;;) {
+		first = last = strtol(list, &end, 10);
+		if (end == list)
+			return -1;
+		if (*end == '-') {
+			list = end + 1;
+			last = strtol(list, &end, 10);
+			if (end == list)
+				return -1;
+		}
+		if (first < 0 || last < first)
+			return -1;
+		for ( ; first <= last && first < cpus_count; ++first)
+			cpus[first] = 1;
+		if (*end != ',')
+			break;
+		list = end + 1;
+	}
+
+	return *end ? -1 : 0;
+}
+
+static void
+power_model_load(void)
+{
+	char line[256], kind[8], list[128], state[16];
+	struct cpu_power *cp;
+	uint32_t lineno = 0;
+	uint8_t *cpus;
+	double mw;
+	long khz;
+	FILE *fp;
+	int cpu;
+
+	fp = fopen(conf_power_model, "r");
+	if (!fp) {
+		fprintf(stderr, FE("Cannot open power model [%s]\n"),
+				conf_power_model);
+		exit(-1);
+	}
+
+	cpus_power = calloc(cpus_count, sizeof(struct cpu_power));
+	cpus = malloc(cpus_count);
+	if (!cpus_power || !cpus)
+		barf("malloc:");
+
+	while (fgets(line, sizeof(line), fp)) {
+		++lineno;
+		line[strcspn(line, "#\n")] = '\0';
+		if (sscanf(line, "%7s", kind) < 1)
+			continue;
+
+		if (!strcmp(kind, "opp")) {
+			if (sscanf(line, "%*s %127s %ld %lf", list, &khz, &mw) < 3)
+				goto exit_error;
+		} else if (!strcmp(kind, "idle")) {
+			if (sscanf(line, "%*s %127s %15s %lf", list, state, &mw) < 3)
+				goto exit_error;
+		} else {
+			goto exit_error;
+		}
+		if (cpulist_parse(list, cpus))
+			goto exit_error;
+
+		for (cpu = 0; cpu < cpus_count; ++cpu) {
+			if (!cpus[cpu])
+				continue;
+			cp = cpus_power + cpu;
+			if (kind[0] == 'o' && cp->opps_count < FREQ_BINS) {
+				cp->opps[cp->opps_count].khz = khz;
+				cp->opps[cp->opps_count++].mw = mw;
+			} else if (kind[0] == 'i' && cp->idle_count < IDLE_STATES_MAX) {
+				strcpy(cp->idle[cp->idle_count].name, state);
+				cp->idle[cp->idle_count++].mw = mw;
+			}
+		}
+	}
+
+	free(cpus);
+	fclose(fp);
+	return;
+
+exit_error:
+
+	fprintf(stderr, FE("Wrong power model [%s:%u]\n"),
+			conf_power_model, lineno);
+	exit(-1);
+}
+
+/* Busy power at a frequency, i.e. of the nearest OPP (0 for unknown) */
+static double
+power_busy_mw(struct cpu_power *cp, long khz)
+{
+	uint32_t i, nearest = 0;
+
+	if (!cp->opps_count)
+		return 0;
+	for (i = 1; i < cp->opps_count; ++i)
+		if (labs(cp->opps[i].khz - khz) <
+				labs(cp->opps[nearest].khz - khz))
+			nearest = i;
+
+	return cp->opps[nearest].mw;
+}
+
+/* Idle power of a cpuidle state (<0 for unknown) */
+static double
+power_idle_mw(struct cpu_power *cp, const char *name)
+{
+	uint32_t i;
+
+	for (i = 0; i < cp->idle_count; ++i)
+		if (!strcmp(cp->idle[i].name, name))
+			return cp->idle[i].mw;
+
+	return -1;
+}
+
+/*
+ * Energy of a CPU over the measurement window [mJ]
+ *
+ * Busy time, from /proc/stat, is spent at the sampled frequencies, each one
+ * in proportion to its residency. Without cpufreq the highest OPP is assumed.
+ * Idle time is spent in the cpuidle states, as accounted by the kernel, any
+ * remainder being accounted at the power of the shallowest modeled state.
+ */
+static double
+energy_cpu(int cpu, double window_s, double *busy_s, double *busy_mj)
+{
+	struct cpu_sampling *cs = cpus_sampling + cpu;
+	struct cpu_power *cp = cpus_power + cpu;
+	double busy_mw = 0, idle_s, state_s, mw, energy = 0;
+	uint32_t i;
+	long khz;
+
+	*busy_s = (double)(cs->busy_ticks[1] - cs->busy_ticks[0])
+		/ sysconf(_SC_CLK_TCK);
+	if (*busy_s > window_s)
+		*busy_s = window_s;
+
+	if (cs->samples) {
+		for (i = 0; i < cs->freqs_count; ++i)
+			busy_mw += power_busy_mw(cp, cs->freqs[i].khz)
+				* cs->freqs[i].samples / cs->samples;
+	} else {
+		for (i = 0, khz = 0; i < cp->opps_count; ++i)
+			if (cp->opps[i].khz > khz)
+				khz = cp->opps[i].khz;
+		busy_mw = power_busy_mw(cp, khz);
+	}
+	*busy_mj = busy_mw * *busy_s;
+	energy += *busy_mj;
+
+	idle_s = window_s - *busy_s;
+	for (i = 0; i < cs->idle_count && idle_s > 0; ++i) {
+		mw = power_idle_mw(cp, cs->idle[i].name);
+		if (mw < 0)
+			continue;
+		state_s = (double)(cs->idle[i].time_us[1] - cs->idle[i].time_us[0])
+			/ S_TO_US;
+		if (state_s > idle_s)
+			state_s = idle_s;
+		energy += mw * state_s;
+		idle_s -= state_s;
+	}
+	if (idle_s > 0 && cp->idle_count)
+		energy += cp->idle[0].mw * idle_s;
+
+	return energy;
+}
+
+/*
+ * Estimated energy: per CPU, overall, and per kind of workers
+ *
+ * The busy energy is charged to the kinds of workers by the CPU time of
+ * their threads, at the average busy power of the platform. Idle energy,
+ * and the busy one of other tasks, is not charged to any kind.
+ */
+static void
+report_energy(void)
+{
+	uint64_t units[ARRAY_SIZE(worker_kind)] = { 0 };
+	double cpu_s[ARRAY_SIZE(worker_kind)] = { 0 };
+	double window_s, busy_s, energy, busy_mj;
+	double busy_total_s = 0, busy_total_mj = 0, charged_mj = 0, mj;
+	double workers_s = 0;
+	uint32_t i;
+	int cpu;
+
+	if (!conf_power_model)
+		return;
+
+	window_s = (double)(idle_snapshot_ns[1] - idle_snapshot_ns[0]) / S_TO_NS;
+	if (window_s <= 0)
+		return;
+
+	printf(FI("Estimated energy:\n"));
+	energy_mj = 0;
+	for (cpu = 0; cpu < cpus_count; ++cpu) {
+		if (!cpus_power[cpu].opps_count && !cpus_power[cpu].idle_count)
+			continue;
+		energy = energy_cpu(cpu, window_s, &busy_s, &busy_mj);
+		printf(FI("cpu%-3d busy %6.1f%%, energy %10.3f [mJ], power %8.1f [mW]\n"),
+			cpu, 100.0 * busy_s / window_s, energy, energy / window_s);
+		energy_mj += energy;
+		busy_total_s += busy_s;
+		busy_total_mj += busy_mj;
+	}
+	printf(FI("total  energy %10.3f [mJ], power %8.1f [mW]\n"),
+		energy_mj, energy_mj / window_s);
+	if (busy_total_s <= 0)
+		return;
+
+	for (i = 0; i < workers_count; ++i) {
+		units[workers_data[i].kind] += workers_data[i].win_loops;
+		cpu_s[workers_data[i].kind] +=
+			(double)workers_data[i].win_cpu_ns / S_TO_NS;
+		workers_s += (double)workers_data[i].win_cpu_ns / S_TO_NS;
+	}
+	/* Workers CPU time can exceed the estimated busy time */
+	if (workers_s > busy_total_s)
+		busy_total_s = workers_s;
+	for (i = 0; i < ARRAY_SIZE(worker_kind); ++i) {
+		if (!units[i] || !cpu_s[i])
+			continue;
+		mj = busy_total_mj * cpu_s[i] / busy_total_s;
+		charged_mj += mj;
+		printf(FI("wlg_%c***: energy %10.3f [mJ], %12.3f [uJ/%s]\n"),
+			worker_kind[i][0], mj, mj * 1000 / units[i],
+			worker_unit[i]);
+	}
+	printf(FI("others  energy %10.3f [mJ] (idle, and other tasks)\n"),
+		(energy_mj > charged_mj) ? energy_mj - charged_mj : 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Quantiles sketches
+////////////////////////////////////////////////////////////////////////////////
+
+static struct sketch *
+sketch_new(void)
+{
+	struct sketch *sk;
+
+	sk = calloc(1, sizeof(struct sketch));
+	if (!sk)
+		barf("calloc:");
+	sk->min = UINT64_MAX;
+
+	return sk;
+}
+
+static void
+sketch_reset(struct sketch *sk)
+{
+	memset(sk, 0, sizeof(struct sketch));
+	sk->min = UINT64_MAX;
+}
+
+static inline uint32_t
+sketch_bucket(uint64_t value)
+{
+	uint32_t shift;
+
+	if (value < SKETCH_SUB_COUNT)
+		return value;
+
+	shift = 63 - __builtin_clzll(value) - SKETCH_SUB_BITS;
+	if (shift >= SKETCH_SHIFTS)
+		return SKETCH_BUCKETS - 1;
+
+	return ((shift + 1) << SKETCH_SUB_BITS)
+		+ (value >> shift) - SKETCH_SUB_COUNT;
+}
+
+/* Return the smallest value accounted in a bucket */
+static uint64_t
+sketch_bucket_value(uint32_t bucket)
+{
+	uint32_t shift;
+
+	if (bucket < SKETCH_SUB_COUNT)
+		return bucket;
+
+	shift = (bucket >> SKETCH_SUB_BITS) - 1;
+	return (uint64_t)((bucket & (SKETCH_SUB_COUNT - 1)) + SKETCH_SUB_COUNT)
+		<< shift;
+}
+
+static inline void
+sketch_add(struct sketch *sk, uint64_t value)
+{
+	++sk->count;
+	sk->sum += value;
+	if (value < sk->min)
+		sk->min = value;
+	if (value > sk->max)
+		sk->max = value;
+	++sk->buckets[sketch_bucket(value)];
+}
+
+static void
+sketch_merge(struct sketch *dst, struct sketch *src)
+{
+	uint32_t b;
+
+	if (!src->count)
+		return;
+
+	dst->count += src->count;
+	dst->sum += src->sum;
+	if (src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+	for (b = 0; b < SKETCH_BUCKETS; ++b)
+		dst->buckets[b] += src->buckets[b];
+}
+
+/* Return the q-quantile (q in [0..1]) of the sketched values */
+static uint64_t
+sketch_quantile(struct sketch *sk, double q)
+{
+	uint64_t rank, seen = 0, value;
+	uint32_t b;
+
+	if (!sk->count)
+		return 0;
+
+	rank = q * (sk->count - 1) + 1;
+	for (b = 0; b < SKETCH_BUCKETS; ++b) {
+		seen += sk->buckets[b];
+		if (seen >= rank)
+			break;
+	}
+
+	/* Report the middle of the bucket, within the observed range */
+	value = sketch_bucket_value(b);
+	if (b + 1 < SKETCH_BUCKETS)
+		value += (sketch_bucket_value(b + 1) - value) / 2;
+	if (value < sk->min)
+		value = sk->min;
+	if (value > sk->max)
+		value = sk->max;
+
+	return value;
+}
+
+/* Print a sketch of values in [ns] */
+static void
+sketch_print(const char *name, const char *what, struct sketch *sk)
+{
+	if (!sk->count)
+		return;
+
+	printf(FI("%-8.8s: %s [us] avg %10.3f, p50 %10.3f, p99 %10.3f, p99.9 %10.3f, max %10.3f (%llu samples)\n"),
+		name, what,
+		(double)sk->sum / sk->count / US_TO_NS,
+		(double)sketch_quantile(sk, 0.50) / US_TO_NS,
+		(double)sketch_quantile(sk, 0.99) / US_TO_NS,
+		(double)sketch_quantile(sk, 0.999) / US_TO_NS,
+		(double)sk->max / US_TO_NS,
+		(unsigned long long)sk->count);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Empirical distributions
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Empirical CDF of a duration, e.g. as measured by tracing
+ *
+ * The file has a "VALUE P" line per point of the CDF, with VALUE [us] and P
+ * its cumulative probability (or count), both non decreasing. The mass of
+ * the first point is on its value, while the one of each next point is
+ * uniformly spread since the previous value. Bins are sampled in O(1)
+ * by means of Walker's alias method.
+ */
+struct dist {
+	uint32_t count;
+	/* Bins bounds [us] */
+	uint32_t *from;
+	uint32_t *to;
+	/* Alias table */
+	double *prob;
+	uint32_t *alias;
+	double mean;
+};
+
+/* Build the alias table of the bins, given their probabilities p */
+static void
+dist_alias(struct dist *dist, double *p)
+{
+	uint32_t *small, *large;
+	uint32_t ns = 0, nl = 0;
+	uint32_t i, s, l;
+
+	small = malloc(dist->count * sizeof(uint32_t));
+	large = malloc(dist->count * sizeof(uint32_t));
+	if (!small || !large)
+		barf("malloc:");
+
+	for (i = 0; i < dist->count; ++i) {
+		p[i] *= dist->count;
+		if (p[i] < 1)
+			small[ns++] = i;
+		else
+			large[nl++] = i;
+	}
+	while (ns && nl) {
+		s = small[--ns];
+		l = large[--nl];
+		dist->prob[s] = p[s];
+		dist->alias[s] = l;
+		p[l] -= 1 - p[s];
+		if (p[l] < 1)
+			small[ns++] = l;
+		else
+			large[nl++] = l;
+	}
+	/* Leftovers are full bins, but for rounding errors */
+	while (nl)
+		dist->prob[large[--nl]] = 1;
+	while (ns)
+		dist->prob[small[--ns]] = 1;
+
+	free(small);
+	free(large);
+}
+
+static struct dist *
+dist_load(const char *path)
+{
+	uint32_t capacity = 64, i;
+	double *cdf, *p, value, cum;
+	struct dist *dist;
+	char line[128];
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (!fp) {
+		fprintf(stderr, FE("Cannot open distribution [%s]\n"), path);
+		exit(-1);
+	}
+
+	dist = calloc(1, sizeof(struct dist));
+	cdf = malloc(capacity * sizeof(double));
+	if (!dist || !cdf)
+		barf("malloc:");
+	dist->to = malloc(capacity * sizeof(uint32_t));
+	if (!dist->to)
+		barf("malloc:");
+
+	while (fgets(line, sizeof(line), fp)) {
+		line[strcspn(line, "#\n")] = '\0';
+		if (sscanf(line, "%lf %lf", &value, &cum) < 2)
+			continue;
+		if (value < 0 || value > UINT32_MAX || cum < 0 || (dist->count &&
+				(value < dist->to[dist->count - 1] ||
+				 cum < cdf[dist->count - 1]))) {
+			fprintf(stderr, FE("Wrong distribution [%s] (not a CDF)\n"), path);
+			exit(-1);
+		}
+		if (dist->count == capacity) {
+			capacity *= 2;
+			cdf = realloc(cdf, capacity * sizeof(double));
+			dist->to = realloc(dist->to, capacity * sizeof(uint32_t));
+			if (!cdf || !dist->to)
+				barf("realloc:");
+		}
+		dist->to[dist->count] = value;
+		cdf[dist->count++] = cum;
+	}
+	fclose(fp);
+	if (!dist->count || cdf[dist->count - 1] <= 0) {
+		fprintf(stderr, FE("Wrong distribution [%s] (empty)\n"), path);
+		exit(-1);
+	}
+
+	dist->from = malloc(dist->count * sizeof(uint32_t));
+	dist->prob = malloc(dist->count * sizeof(double));
+	dist->alias = calloc(dist->count, sizeof(uint32_t));
+	p = malloc(dist->count * sizeof(double));
+	if (!dist->from || !dist->prob || !dist->alias || !p)
+		barf("malloc:");
+
+	for (i = 0; i < dist->count; ++i) {
+		dist->from[i] = i ? dist->to[i - 1] : dist->to[0];
+		p[i] = (cdf[i] - (i ? cdf[i - 1] : 0)) / cdf[dist->count - 1];
+		dist->mean += p[i] * ((double)dist->from[i] + dist->to[i]) / 2;
+	}
+	dist_alias(dist, p);
+
+	free(p);
+	free(cdf);
+
+	return dist;
+}
+
+/* Printouts of workers with empirical distributions report their means */
+#define DIST_NOTE(wdata) \
+	(((wdata)->dist[0] || (wdata)->dist[1]) ? " (@: empirical mean)" : "")
+
+static void
+dist_free(struct dist *dist)
+{
+	if (!dist)
+		return;
+	free(dist->from);
+	free(dist->to);
+	free(dist->prob);
+	free(dist->alias);
+	free(dist);
+}
+
+/*
+ * Parse a duration parameter: either a value [us] or "@FILE", i.e. an
+ * empirical distribution, in which case its mean is returned.
+ */
+static uint32_t
+dist_param(const char *param, struct dist **dist)
+{
+	uint32_t value = 0;
+
+	*dist = NULL;
+	if (param && param[0] == '@') {
+		*dist = dist_load(param + 1);
+		return (*dist)->mean;
+	}
+	if (param)
+		sscanf(param, "%u", &value);
+
+	return value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Load tracking
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * The kernel PELT signals are geometric series over 1024 [us] periods, with
+ * a decay factor y such that y^32 = 0.5. Here they are computed in continuous
+ * time, from the workers own view of when they are running (util) or either
+ * running or waiting to run after a wakeup (runnable). Unlike the kernel ones,
+ * these are neither frequency nor CPU capacity invariant.
+ */
+#define PELT_PERIOD_NS   (1024 * US_TO_NS)
+#define PELT_HALFLIFE_NS (32ULL * PELT_PERIOD_NS)
+
+static pthread_t pelt_sampler;
+static volatile int pelt_done = 0;
+
+/* Estimated vs kernel utilization of a worker, over the whole test */
+struct pelt_stats {
+	double est_sum;
+	double kernel_sum;
+	double error_sum;
+	uint64_t samples;
+};
+
+static struct pelt_stats *pelt_stats;
+
+/* Signals of p projected at now_ns, without changing them */
+static void
+pelt_project(struct pelt *p, uint64_t now_ns, double *util, double *runnable)
+{
+	double decay = 1;
+
+	if (now_ns > p->last_ns)
+		decay = exp2(-(double)(now_ns - p->last_ns) / PELT_HALFLIFE_NS);
+
+	*util = p->util * decay;
+	*runnable = p->runnable * decay;
+	if (p->state >= PELT_RUNNABLE)
+		*runnable += 1024 * (1 - decay);
+	if (p->state == PELT_RUNNING)
+		*util += 1024 * (1 - decay);
+}
+
+/* Account the time since the last update, then switch to a new state */
+static void
+pelt_update(struct wdata *wdata, uint64_t now_ns, uint8_t state)
+{
+	struct pelt *p = &wdata->pelt;
+	double util, runnable;
+
+	if (!conf_pelt_ms)
+		return;
+
+	pelt_project(p, now_ns, &util, &runnable);
+
+	__atomic_store_n(&p->seq, p->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	p->util = util;
+	p->runnable = runnable;
+	p->last_ns = now_ns;
+	p->state = state;
+	__atomic_store_n(&p->seq, p->seq + 1, __ATOMIC_RELEASE);
+}
+
+/* Estimated signals of a worker at now_ns */
+static void
+pelt_read(struct wdata *wdata, uint64_t now_ns, double *util, double *runnable)
+{
+	struct pelt *p = &wdata->pelt;
+	struct pelt snapshot;
+	uint32_t seq;
+
+	do {
+		seq = __atomic_load_n(&p->seq, __ATOMIC_ACQUIRE);
+		snapshot = *p;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while ((seq & 1) || seq != __atomic_load_n(&p->seq, __ATOMIC_RELAXED));
+
+	pelt_project(&snapshot, now_ns, util, runnable);
+}
+
+/*
+ * Kernel signals of a worker, from its sched debug file (requires
+ * CONFIG_SCHED_DEBUG). Signals of a sleeping task are updated only when it
+ * wakes up. Missing values are set to -1.
+ */
+static void
+pelt_kernel(struct wdata *wdata, long *util, long *load, long *runnable)
+{
+	char path[64], line[128];
+	FILE *fp;
+
+	*util = *load = *runnable = -1;
+
+	snprintf(path, sizeof(path), "/proc/self/task/%u/sched", wdata->pid);
+	fp = fopen(path, "r");
+	if (!fp)
+		return;
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "se.avg.util_avg : %ld", util) == 1)
+			continue;
+		if (sscanf(line, "se.avg.load_avg : %ld", load) == 1)
+			continue;
+		sscanf(line, "se.avg.runnable_avg : %ld", runnable);
+	}
+	fclose(fp);
+}
+
+static void
+pelt_csv_value(FILE *fp, long value)
+{
+	if (value >= 0)
+		fprintf(fp, ",%ld", value);
+	else
+		fprintf(fp, ",");
+}
+
+/*
+ * Sample estimated and kernel signals of all the workers, over all the
+ * phases, till the main thread stops the sampler after the last one
+ */
+static void *
+pelt_thread(void *arg)
+{
+	uint64_t start_ns = timespec_nanoseconds(&start_ts);
+	double util, runnable;
+	long k_util, k_load, k_runnable;
+	struct timespec next_ts;
+	struct pelt_stats *ps;
+	struct wdata *wdata;
+	uint64_t now_ns;
+	uint32_t i;
+	FILE *fp;
+
+	(void)arg;
+
+	fp = fopen(conf_pelt_file, "w");
+	if (!fp)
+		barf("pelt fopen:");
+	fprintf(fp, "time_ms,worker,util_est,runnable_est,"
+		"util_avg,load_avg,runnable_avg\n");
+
+	/* Timers do not support CLOCK_MONOTONIC_RAW */
+	clock_gettime(CLOCK_MONOTONIC, &next_ts);
+	for (;;) {
+		timespec_add_us(&next_ts, conf_pelt_ms * 1000);
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_ts, NULL);
+		if (pelt_done)
+			break;
+
+		now_ns = timespec_now_ns();
+
+		for (i = 0; i < workers_count; ++i) {
+			wdata = workers_data + i;
+			pelt_read(wdata, now_ns, &util, &runnable);
+			pelt_kernel(wdata, &k_util, &k_load, &k_runnable);
+			fprintf(fp, "%.3f,%s,%.1f,%.1f",
+				(double)(now_ns - start_ns) / MS_TO_NS,
+				wdata->name, util, runnable);
+			pelt_csv_value(fp, k_util);
+			pelt_csv_value(fp, k_load);
+			pelt_csv_value(fp, k_runnable);
+			fprintf(fp, "\n");
+
+			if (k_util < 0)
+				continue;
+			ps = pelt_stats + i;
+			ps->est_sum += util;
+			ps->kernel_sum += k_util;
+			ps->error_sum += fabs(util - k_util);
+			++ps->samples;
+		}
+	}
+
+	fclose(fp);
+
+	return NULL;
+}
+
+static void
+pelt_start(void)
+{
+	if (!conf_pelt_ms)
+		return;
+
+	pelt_stats = calloc(workers_count, sizeof(struct pelt_stats));
+	if (!pelt_stats)
+		barf("calloc:");
+	if (pthread_create(&pelt_sampler, NULL, pelt_thread, NULL))
+		barf("pthread_create:");
+}
+
+static void
+pelt_stop(void)
+{
+	if (!conf_pelt_ms)
+		return;
+
+	pelt_done = 1;
+	pthread_join(pelt_sampler, NULL);
+}
+
+/* Average estimated vs kernel utilization, the details are in the CSV */
+static void
+report_pelt(void)
+{
+	struct pelt_stats *ps;
+	uint32_t i;
+
+	if (!conf_pelt_ms)
+		return;
+
+	printf(FI("Load tracking (time series in %s):\n"), conf_pelt_file);
+	for (i = 0; i < workers_count; ++i) {
+		ps = pelt_stats + i;
+		if (!ps->samples)
+			continue;
+		printf(FI("%-8.8s: util avg estimated %6.1f, kernel %6.1f, "
+			"mean abs difference %6.1f (%llu samples)\n"),
+			workers_data[i].name, ps->est_sum / ps->samples,
+			ps->kernel_sum / ps->samples,
+			ps->error_sum / ps->samples,
+			(unsigned long long)ps->samples);
+	}
+	free(pelt_stats);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Latency attribution
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Each worker keeps track of the intervals of time it was running on each
+ * CPU. While running, workers periodically "tick": a change of CPU, or a
+ * difference between the wall and the thread CPU time elapsed since the
+ * previous tick, closes the current interval. Sleeping workers close it
+ * explicitly before going to sleep.
+ *
+ * A wakeup latency above the threshold is recorded as a spike, which is
+ * attributed at the end of the run to the workers which occupied the same
+ * CPU while the victim was waiting for it.
+ */
+#define OCC_PREEMPT_NS  (50 * US_TO_NS)
+#define ATTR_SPIKES_MAX 256
+
+static void
+occupancy_push(struct wdata *wdata)
+{
+	wdata->occ[wdata->occ_next] = wdata->occ_cur;
+	if (++wdata->occ_next == conf_attr_records) {
+		wdata->occ_next = 0;
+		wdata->occ_wrapped = 1;
+	}
+	wdata->occ_cur.cpu = -1;
+}
+
+/* Account the current interval as not running anymore */
+static void
+occupancy_stop(struct wdata *wdata)
+{
+	if (!conf_attr_us || wdata->occ_cur.cpu < 0)
+		return;
+
+	wdata->occ_cur.end_ns = timespec_now_ns();
+	occupancy_push(wdata);
+}
+
+/* Account the calling worker as running at now_ns */
+static void
+occupancy_tick(struct wdata *wdata, uint64_t now_ns)
+{
+	struct timespec cpu_ts;
+	uint64_t cpu_ns;
+	int32_t cpu;
+
+	if (!conf_attr_us)
+		return;
+
+	cpu = sched_getcpu();
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_ts);
+	cpu_ns = timespec_nanoseconds(&cpu_ts);
+
+	if (wdata->occ_cur.cpu >= 0) {
+		uint64_t ran_ns = cpu_ns - wdata->occ_last_cpu_ns;
+
+		if (now_ns - wdata->occ_last_ns > ran_ns + OCC_PREEMPT_NS) {
+			/* Preempted since last tick: assume we run first */
+			wdata->occ_cur.end_ns = wdata->occ_last_ns + ran_ns;
+			occupancy_push(wdata);
+		} else if (cpu != wdata->occ_cur.cpu) {
+			/* Migrated since last tick */
+			wdata->occ_cur.end_ns = now_ns;
+			occupancy_push(wdata);
+		}
+	}
+
+	if (wdata->occ_cur.cpu < 0) {
+		wdata->occ_cur.start_ns = now_ns;
+		wdata->occ_cur.cpu = cpu;
+	}
+	wdata->occ_last_ns = now_ns;
+	wdata->occ_last_cpu_ns = cpu_ns;
+}
+
+/* Account a wakeup which was expected at wake_ts */
+static void
+worker_wakeup(struct wdata *wdata, struct timespec *wake_ts)
+{
+	uint64_t wake_ns = timespec_nanoseconds(wake_ts);
+	uint64_t now_ns = timespec_now_ns();
+	uint64_t lat_ns = (now_ns > wake_ns) ? now_ns - wake_ns : 0;
+	struct spike *spike;
+
+	log_event(wdata, now_ns, WLG_EV_WAKEUP, lat_ns);
+	occupancy_tick(wdata, now_ns);
+	pelt_update(wdata, wake_ns, PELT_RUNNABLE);
+	pelt_update(wdata, now_ns, PELT_RUNNING);
+
+	if (!measuring(now_ns))
+		return;
+	sketch_add(wdata->lat, lat_ns);
+
+	if (!conf_attr_us || lat_ns < (uint64_t)conf_attr_us * US_TO_NS)
+		return;
+
+	if (wdata->spikes_count++ >= ATTR_SPIKES_MAX)
+		return;
+
+	spike = wdata->spikes + wdata->spikes_count - 1;
+	spike->from_ns = wake_ns;
+	spike->to_ns = now_ns;
+	spike->cpu = wdata->occ_cur.cpu;
+}
+
+static void
+attribution_setup(struct wdata *wdata)
+{
+	wdata->occ_cur.cpu = -1;
+	if (!conf_attr_us)
+		return;
+
+	wdata->occ = calloc(conf_attr_records, sizeof(struct occupancy));
+	wdata->spikes = calloc(ATTR_SPIKES_MAX, sizeof(struct spike));
+	if (!wdata->occ || !wdata->spikes)
+		barf("calloc:");
+}
+
+static void
+report_attribution(void)
+{
+	struct wdata *victim, *other;
+	struct occupancy *occ;
+	struct spike *spike;
+	uint64_t overlap_ns, from_ns, to_ns;
+	uint32_t v, o, r, s, records;
+	uint8_t truncated, found;
+
+	if (!conf_attr_us)
+		return;
+
+	printf(FI("Latency spikes above %u [us]:\n"), conf_attr_us);
+	for (v = 0; v < workers_count; ++v) {
+		victim = workers_data + v;
+		if (!victim->spikes_count)
+			continue;
+		if (victim->spikes_count > ATTR_SPIKES_MAX)
+			printf(FI("%-8.8s: %u spikes, only first %u attributed\n"),
+				victim->name, victim->spikes_count,
+				ATTR_SPIKES_MAX);
+
+		for (s = 0; s < victim->spikes_count && s < ATTR_SPIKES_MAX; ++s) {
+			spike = victim->spikes + s;
+			printf(FI("%-8.8s: %9.3f [us] latency on CPU%d @ %.3f [ms]:"),
+				victim->name,
+				(float)(spike->to_ns - spike->from_ns) / US_TO_NS,
+				spike->cpu,
+				(float)(spike->from_ns - timespec_nanoseconds(&start_ts))
+					/ MS_TO_NS);
+
+			found = truncated = 0;
+			for (o = 0; o < workers_count; ++o) {
+				other = workers_data + o;
+				if (other == victim)
+					continue;
+
+				records = other->occ_wrapped ?
+					conf_attr_records : other->occ_next;
+				if (other->occ_wrapped &&
+					other->occ[other->occ_next].start_ns > spike->from_ns)
+					truncated = 1;
+
+				overlap_ns = 0;
+				for (r = 0; r < records; ++r) {
+					occ = other->occ + r;
+					if (occ->cpu != spike->cpu)
+						continue;
+					from_ns = (occ->start_ns > spike->from_ns) ?
+						occ->start_ns : spike->from_ns;
+					to_ns = (occ->end_ns < spike->to_ns) ?
+						occ->end_ns : spike->to_ns;
+					if (to_ns > from_ns)
+						overlap_ns += to_ns - from_ns;
+				}
+				if (!overlap_ns)
+					continue;
+
+				printf(" %s (%.3f [us])", other->name,
+					(float)overlap_ns / US_TO_NS);
+				found = 1;
+			}
+			if (!found)
+				printf(" no wlg workers");
+			if (truncated)
+				printf(" (timeline truncated)");
+			printf("\n");
+		}
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Sleep mechanisms
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Workers sleep until an absolute deadline by means of one of these
+ * mechanisms, with a per thread timer slack (0: the default one, i.e.
+ * 50 [us] for normal threads). When more are configured, they are assigned
+ * round robin to the workers of each kind, so that they are compared on the
+ * same workload. Relative sleeps are set on the CLOCK_MONOTONIC_RAW
+ * timeline, absolute ones on the CLOCK_MONOTONIC one, while epoll and poll
+ * timeouts are rounded up to [ms].
+ */
+#define SLEEP_USLEEP    0
+#define SLEEP_NANOSLEEP 1
+#define SLEEP_ABSOLUTE  2
+#define SLEEP_TIMERFD   3
+#define SLEEP_FUTEX     4
+#define SLEEP_EPOLL     5
+#define SLEEP_POLL      6
+#define SLEEP_HYBRID    7
+static const char *sleep_name[] = {
+	"usleep", "nanosleep", "absolute", "timerfd", "futex", "epoll", "poll",
+	"hybrid" };
+/* Deadline within the spin margin: not sleeping at all */
+#define SLEEP_NONE      8
+
+/*
+ * The hybrid mechanism sleeps until a margin before the deadline, and spins
+ * for the rest. With a --spin-margin, INTERACTIVE and PERIODIC workers do the
+ * same with whatever mechanism they use. The time spun is not useful work,
+ * but the CPU cost of waking up on time.
+ */
+#define SLEEP_SPIN_MARGIN_US 50
+
+#define SLEEPS_MAX 16
+struct sleep_conf {
+	uint8_t mech;
+	uint32_t slack_ns;
+};
+static struct sleep_conf sleeps[SLEEPS_MAX] = { { SLEEP_USLEEP, 0 } };
+static uint32_t sleeps_count = 1;
+
+/* Parse a "MECH[:SLACK][,MECH[:SLACK]..]" list, return 0 on success */
+static int
+sleep_parse(const char *spec)
+{
+	size_t len;
+	uint8_t m;
+
+	for (sleeps_count = 0; *spec; ++sleeps_count) {
+		if (sleeps_count == SLEEPS_MAX)
+			return -1;
+		len = strcspn(spec, ":,");
+		for (m = 0; m < ARRAY_SIZE(sleep_name); ++m)
+			if (strlen(sleep_name[m]) == len &&
+					!strncmp(spec, sleep_name[m], len))
+				break;
+		if (m == ARRAY_SIZE(sleep_name))
+			return -1;
+		sleeps[sleeps_count].mech = m;
+		sleeps[sleeps_count].slack_ns = 0;
+		spec += len;
+		if (*spec == ':' && sscanf(++spec, "%u",
+				&sleeps[sleeps_count].slack_ns) < 1)
+			return -1;
+		spec += strcspn(spec, ",");
+		if (*spec == ',' && !*++spec)
+			return -1;
+	}
+
+	return sleeps_count ? 0 : -1;
+}
+
+static void
+sleep_setup(struct wdata *wdata)
+{
+	struct sleep_conf *conf;
+
+	/* The probe worker has id 0 */
+	wdata->sleep = wdata->id ? (wdata->id - 1) % sleeps_count : 0;
+	conf = sleeps + wdata->sleep;
+	wdata->sleep_fd = -1;
+	if (conf_sleep || conf_spin_margin_us)
+		wdata->oversleep = sketch_new();
+
+	if (conf->mech == SLEEP_HYBRID)
+		wdata->spin_margin_ns = (uint64_t)(conf_spin_margin_us ?
+			conf_spin_margin_us : SLEEP_SPIN_MARGIN_US) * US_TO_NS;
+	if (conf_spin_margin_us && !worker_probe(wdata) &&
+			(wdata->kind == WORKER_INTERACTIVE ||
+			 wdata->kind == WORKER_PERIODC))
+		wdata->spin_margin_ns = (uint64_t)conf_spin_margin_us * US_TO_NS;
+
+	if (conf->slack_ns && prctl(PR_SET_TIMERSLACK, conf->slack_ns, 0, 0, 0))
+		barf("prctl:");
+
+	switch (conf->mech) {
+	case SLEEP_TIMERFD:
+		wdata->sleep_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+		if (wdata->sleep_fd < 0)
+			barf("timerfd_create:");
+		break;
+	case SLEEP_EPOLL:
+		/* Nothing ever becomes ready, but for the timeout */
+		wdata->sleep_fd = epoll_create1(EPOLL_CLOEXEC);
+		if (wdata->sleep_fd < 0)
+			barf("epoll_create1:");
+		break;
+	}
+}
+
+/* Sleep until wake_ns, on the timespec_now_ns() timeline */
+static void
+worker_sleep(struct wdata *wdata, uint64_t wake_ns)
+{
+	uint64_t now_ns = timespec_now_ns();
+	uint64_t delay_ns, spin_ns;
+	struct itimerspec its;
+	struct epoll_event ev;
+	struct timespec ts;
+	uint8_t mech;
+
+	if (wake_ns <= now_ns)
+		return;
+	delay_ns = wake_ns - now_ns;
+	mech = sleeps[wdata->sleep].mech;
+
+	/* Sleep until the spin margin before the deadline */
+	spin_ns = (delay_ns < wdata->spin_margin_ns) ?
+		delay_ns : wdata->spin_margin_ns;
+	delay_ns -= spin_ns;
+
+	switch (delay_ns ? mech : SLEEP_NONE) {
+	case SLEEP_USLEEP:
+		usleep(delay_ns / US_TO_NS);
+		break;
+	case SLEEP_NANOSLEEP:
+		ts.tv_sec = delay_ns / S_TO_NS;
+		ts.tv_nsec = delay_ns % S_TO_NS;
+		nanosleep(&ts, NULL);
+		break;
+	case SLEEP_EPOLL:
+		epoll_wait(wdata->sleep_fd, &ev, 1,
+			(delay_ns + MS_TO_NS - 1) / MS_TO_NS);
+		break;
+	case SLEEP_POLL:
+		poll(NULL, 0, (delay_ns + MS_TO_NS - 1) / MS_TO_NS);
+		break;
+	case SLEEP_NONE:
+		break;
+	default:
+		/* Absolute deadline, on the CLOCK_MONOTONIC timeline */
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		timespec_add_ns(&ts, delay_ns % S_TO_NS);
+		ts.tv_sec += delay_ns / S_TO_NS;
+		if (mech == SLEEP_TIMERFD) {
+			memset(&its, 0, sizeof(its));
+			its.it_value = ts;
+			if (!timerfd_settime(wdata->sleep_fd, TFD_TIMER_ABSTIME,
+					&its, NULL))
+				read(wdata->sleep_fd, &delay_ns, sizeof(delay_ns));
+		} else if (mech == SLEEP_FUTEX) {
+			/* Nobody ever wakes it up, but the timeout */
+			syscall(SYS_futex, &wdata->sleep_futex,
+				FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG, 0, &ts,
+				NULL, FUTEX_BITSET_MATCH_ANY);
+		} else {
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+		}
+	}
+
+	/* Spin on the vDSO clock for the rest, unless already late */
+	now_ns = timespec_now_ns();
+	if (spin_ns) {
+		spin_ns = now_ns;
+		while (now_ns < wake_ns)
+			now_ns = timespec_now_ns();
+		if (measuring(now_ns))
+			wdata->spin_ns += now_ns - spin_ns;
+	}
+
+	if (wdata->oversleep && measuring(now_ns))
+		sketch_add(wdata->oversleep, (now_ns > wake_ns) ?
+			now_ns - wake_ns : 0);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Workers definition
+////////////////////////////////////////////////////////////////////////////////
+
+/* Block until we're ready to go */
+static void
+sync_start(struct wdata *wdata)
+{
+	/* Unlike a condition, a barrier cannot miss its wakeup */
+	pthread_barrier_wait(&phase_barrier);
+
+	DB(printf(WD("started\n")));
+}
+
+/* Park until the next phase has been setup */
+static void
+sync_end(struct wdata *wdata)
+{
+	pthread_barrier_wait(&phase_barrier);
+
+	DB(printf(WD("parked\n")));
+}
+
+/* Parse a "P:K,A,B[,A,B..]" phase specification, return 0 on success */
+static int
+phase_spec_parse(const char *spec)
+{
+	struct phase_spec *ps = phase_specs + phase_specs_count;
+	uint32_t count = 0, capacity = 8, i;
+	char kind, *end;
+
+	if (phase_specs_count == PHASE_SPECS_MAX)
+		return -1;
+	if (sscanf(spec, "%u:%c,", &ps->phase, &kind) < 2 || ps->phase < 2)
+		return -1;
+	ps->kind = (kind == 'i') ? WORKER_INTERACTIVE :
+		(kind == 'p') ? WORKER_PERIODC :
+		(kind == 'y') ? WORKER_YIELD : WORKER_BATCH;
+	if (ps->kind == WORKER_BATCH)
+		return -1;
+
+	ps->values = malloc(capacity * sizeof(uint32_t));
+	if (!ps->values)
+		barf("malloc:");
+	spec = strchr(spec, ',');
+	while (spec && *spec++) {
+		if (count == capacity) {
+			capacity *= 2;
+			ps->values = realloc(ps->values,
+				capacity * sizeof(uint32_t));
+			if (!ps->values)
+				barf("realloc:");
+		}
+		/* Durations only, empirical distributions are not re-armed */
+		ps->values[count++] = strtoul(spec, &end, 10);
+		if (end == spec || (*end && *end != ','))
+			return -1;
+		spec = *end ? end : NULL;
+	}
+	if (!count || count % 2)
+		return -1;
+	ps->pairs = count / 2;
+
+	for (i = 0; i < ps->pairs; ++i) {
+		if (ps->kind == WORKER_PERIODC && ps->values[2 * i + 1] > 100)
+			return -1;
+		if (ps->kind == WORKER_YIELD &&
+				ps->values[2 * i + 1] > ps->values[2 * i])
+			return -1;
+	}
+
+	++phase_specs_count;
+	return 0;
+}
+
+
+#define BUSY_LOOP_ITERATIONS 65536
+
+static void
+busy_loop(void)
+{
+	volatile uint16_t i = 1;
+	for ( ; i ; ++i);
+}
+
+/* A fraction of a busy_loop(), i.e. a finer grained unit of work */
+static void
+busy_spin(uint16_t iterations)
+{
+	volatile uint16_t i = iterations;
+	for ( ; i ; --i);
+}
+
+/* Fast per-worker xorshift generator, does not serialize on libc locks */
+static inline uint32_t
+worker_random(struct wdata *wdata)
+{
+	uint32_t x = wdata->rnd;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	wdata->rnd = x;
+
+	return x;
+}
+
+/* Uniformly distributed value in [0..max_value] */
+static inline uint32_t
+normal_random(struct wdata *wdata, uint32_t max_value)
+{
+	double value = max_value;
+	value *= worker_random(wdata);
+	value /= UINT32_MAX;
+	return value;
+}
+
+/* Exponentially distributed value, e.g. Poisson inter-arrival times */
+static inline uint32_t
+exponential_random(struct wdata *wdata, double mean)
+{
+	double value;
+
+	value = -mean * log(((double)worker_random(wdata) + 1)
+			/ ((double)UINT32_MAX + 2));
+	return (value < UINT32_MAX) ? value : UINT32_MAX;
+}
+
+/*
+ * Seed of a worker, derived from the master seed and the worker kind and
+ * index only, thus the same on every run with the same seed
+ */
+static uint32_t
+worker_seed(struct wdata *wdata)
+{
+	uint64_t x = conf_seed ^ ((uint64_t)wdata->kind << 32 | wdata->id);
+
+	/* splitmix64 finalizer */
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+
+	/* The xorshift state must not be zero */
+	return (uint32_t)x ? (uint32_t)x : 1;
+}
+
+/* Sample a duration [us] from an empirical distribution */
+static uint32_t
+dist_sample(struct wdata *wdata, struct dist *dist)
+{
+	double u = (double)worker_random(wdata) / 4294967296.0 * dist->count;
+	uint32_t bin = u;
+
+	u -= bin;
+	if (u >= dist->prob[bin])
+		bin = dist->alias[bin];
+
+	u = (double)worker_random(wdata) / 4294967296.0;
+	return dist->from[bin] + u * (dist->to[bin] - dist->from[bin]);
+}
+
+/*
+ * Large instruction footprint support
+ *
+ * FOOTPRINT_FUNCS distinct (not inlined) functions are generated by the
+ * preprocessor, each one with its own constants so that the compiler cannot
+ * merge them. The return value of each function selects the next one to call,
+ * thus the call sequence is data dependent and the indirect branch predictor
+ * cannot learn it either.
+ */
+#define FOOTPRINT_FUNCS 1024
+#define FOOTPRINT_CALLS 256
+
+#define FP_STEP(v, k) \
+	x ^= x << (((v) + (k)) % 7 + 5); \
+	x += 0x9e3779b9u * ((v) + (k) + 1); \
+	x ^= x >> (((v) * 3 + (k)) % 11 + 3); \
+	x *= 2 * ((v) * 977 + (k) * 131) + 1;
+
+#define FP_FUNC(t, v) \
+static __attribute__((noinline)) uint32_t \
+fp_func_##t(uint32_t x) \
+{ \
+	FP_STEP(v, 0) FP_STEP(v, 1) FP_STEP(v, 2) FP_STEP(v, 3) \
+	FP_STEP(v, 4) FP_STEP(v, 5) FP_STEP(v, 6) FP_STEP(v, 7) \
+	return x; \
+}
+
+#define FP_PTR(t, v) fp_func_##t,
+
+#define FP_R4(m, t, v) \
+	m(t##0, (v) * 4 + 0) m(t##1, (v) * 4 + 1) \
+	m(t##2, (v) * 4 + 2) m(t##3, (v) * 4 + 3)
+#define FP_R16(m, t, v) \
+	FP_R4(m, t##0, (v) * 4 + 0) FP_R4(m, t##1, (v) * 4 + 1) \
+	FP_R4(m, t##2, (v) * 4 + 2) FP_R4(m, t##3, (v) * 4 + 3)
+#define FP_R64(m, t, v) \
+	FP_R16(m, t##0, (v) * 4 + 0) FP_R16(m, t##1, (v) * 4 + 1) \
+	FP_R16(m, t##2, (v) * 4 + 2) FP_R16(m, t##3, (v) * 4 + 3)
+#define FP_R256(m, t, v) \
+	FP_R64(m, t##0, (v) * 4 + 0) FP_R64(m, t##1, (v) * 4 + 1) \
+	FP_R64(m, t##2, (v) * 4 + 2) FP_R64(m, t##3, (v) * 4 + 3)
+#define FP_R1024(m) \
+	FP_R256(m, 0, 0) FP_R256(m, 1, 1) \
+	FP_R256(m, 2, 2) FP_R256(m, 3, 3)
+
+FP_R1024(FP_FUNC)
+
+static uint32_t (*fp_funcs[FOOTPRINT_FUNCS])(uint32_t) = {
+	FP_R1024(FP_PTR)
+};
+
+/*
+ * Unpredictable branches support
+ *
+ * Each worker walks a private array of random bytes and takes a branch
+ * depending on each one of them. The empty asm statements keep the compiler
+ * from converting the branch into a conditional move.
+ */
+#define MISPREDICT_SIZE 16384
+
+/*
+ * Shared counters contention support
+ *
+ * All the CONTENTION workers update their own counter within a shared area.
+ * Depending on the configured layout, counters of different workers are
+ * packed within the same cache line, placed on adjacent cache lines or
+ * padded far enough to not be affected by adjacent lines prefetching.
+ */
+#define CONTENTION_LAYOUT_LINE     0
+#define CONTENTION_LAYOUT_ADJACENT 1
+#define CONTENTION_LAYOUT_PADDED   2
+#define CONTENTION_PADDING         (4 * CACHELINE_SIZE)
+#define CONTENTION_OPS             1024
+
+static uint64_t *contention_counters;
+
+/*
+ * Cache-to-cache data hand-off support
+ *
+ * A producer fills a buffer, timestamps it and hands its ownership over to
+ * the consumer by means of a flag. The consumer reads the whole buffer back
+ * and gives ownership back to the producer. The time from the hand-off to the
+ * end of the read is the cost of moving the data across the two CPUs.
+ * Waits are spinning, but they yield the CPU once in a while so that the two
+ * workers can also share the same CPU.
+ */
+#define HANDOFF_SPINS 1024
+
+struct handoff {
+	/* Ownership flag: set by the producer, cleared by the consumer */
+	volatile uint32_t full;
+	int32_t cpu;
+	uint64_t handoff_ns;
+	uint64_t *buffer;
+	uint32_t words;
+} __attribute__((aligned(CACHELINE_SIZE)));
+
+static struct handoff *handoff_pairs;
+
+/*
+ * Wakeup dependencies graph (DAG) of workers, e.g. the frames pipeline of
+ * an interactive device: input -> UI -> render -> compositor.
+ *
+ * Frames are started on a fixed period by the first node, which acts as the
+ * vsync source, while every other node runs a burst of each frame once all
+ * its predecessors (or the vsync, for source nodes) completed it. Frames can
+ * be pipelined, up to DAG_FRAMES of them being in flight: when the pipeline
+ * is full, or the first node misses a vsync, the frame is dropped. A frame
+ * is janky when its end to end latency, till the completion of all the sink
+ * nodes, exceeds the period.
+ */
+#define DAG_NODES_MAX 16
+#define DAG_FRAMES    8
+
+struct dag_node {
+	uint32_t burst_us;
+	/* Predecessors to wait for, including the vsync for source nodes */
+	uint8_t preds_count;
+	uint8_t succs_count;
+	uint8_t succs[DAG_NODES_MAX];
+	uint8_t source;
+	uint8_t sink;
+	sem_t ready;
+	/* Predecessors still running, and readiness time, of frames in flight */
+	uint32_t remaining[DAG_FRAMES];
+	uint64_t ready_ns[DAG_FRAMES];
+	/* Next frame to run, owned by the node worker */
+	uint64_t frame;
+} __attribute__((aligned(CACHELINE_SIZE)));
+
+struct dag {
+	struct dag_node nodes[DAG_NODES_MAX];
+	uint8_t nodes_count;
+	uint8_t sinks_count;
+	uint32_t period_us;
+	volatile int stop;
+
+	/* Frames clock, owned by the vsync node */
+	uint64_t start_ns;
+	uint64_t next_vsync;
+
+	/* Frames in flight, the vsync node counts the started ones */
+	uint64_t frames_done;
+	uint64_t frame_start_ns[DAG_FRAMES];
+	uint32_t sinks_remaining[DAG_FRAMES];
+
+	/* Statistics, within the measurement window */
+	pthread_mutex_t stats_mtx;
+	struct sketch *lat;
+	uint64_t frames;
+	uint64_t janks;
+	uint64_t dropped;
+};
+
+static struct dag *dag = NULL;
+
+/*
+ * Audio path: a producer fills a buffer every period, which a consumer,
+ * modelling the audio device, plays at the same rate from a ring of buffers.
+ * The consumer starts playing once the ring has been filled, but for a
+ * buffer, thus the producer has that many periods of slack. A buffer not
+ * ready when it has to be played is an underrun, i.e. a glitch the user
+ * hears, while a producer finding the ring full is an overrun.
+ */
+#define AUDIO_SAMPLES 256
+
+struct audio {
+	uint32_t period_us;
+	uint32_t burst_us;
+	uint32_t ring_size;
+	uint32_t *ring;
+
+	/* Next buffer to produce and to play */
+	uint64_t produced;
+	uint64_t consumed;
+
+	/* Next period of each thread, owned by it */
+	uint64_t producer_tick;
+	uint64_t consumer_tick;
+
+	/* Statistics, within the measurement window */
+	uint64_t buffers;
+	uint64_t underruns;
+	uint64_t overruns;
+	/* Producer completion delay, beyond the burst duration */
+	struct sketch *late;
+} __attribute__((aligned(CACHELINE_SIZE)));
+
+static struct audio *audio_paths = NULL;
+
+/*
+ * Thread churn: a worker keeps spawning short lived threads, each running a
+ * burst and exiting, either at a fixed rate or as fast as possible, with up
+ * to a maximum number of them alive at once. Threads are detached, and hand
+ * their timestamps back to the worker through their slot.
+ */
+#define CHURN_SLOTS_MAX 1024
+
+#define CHURN_FREE    0
+#define CHURN_RUNNING 1
+#define CHURN_DONE    2
+
+struct churn_slot {
+	int state;
+	uint32_t burst_us;
+	uint64_t spawn_ns;
+	uint64_t run_ns;
+	uint64_t exit_ns;
+} __attribute__((aligned(CACHELINE_SIZE)));
+
+struct churn {
+	uint32_t rate;
+	uint32_t burst_us;
+	uint16_t concurrency;
+	pthread_attr_t attr;
+	struct churn_slot *slots;
+	uint64_t next_ns;
+
+	/* Statistics, within the measurement window */
+	uint64_t failed;
+	uint64_t missed;
+	/* pthread_create() duration, spawn to first run and first run to exit */
+	struct sketch *spawn;
+	struct sketch *first_run;
+	struct sketch *lifetime;
+};
+
+static struct churn *churns = NULL;
+
+/*
+ * Processes storm: a worker keeps forking a child, and waiting for it. The
+ * child exits right away, or execs either wlg itself as a minimal helper,
+ * which reports when it started running, or any other binary.
+ */
+#define STORM_FORK 0
+#define STORM_SELF 1
+#define STORM_PATH 2
+
+/* Shared with the children, which write it */
+struct storm_child {
+	uint64_t run_ns;
+	uint64_t exec_ns;
+};
+
+struct storm {
+	uint32_t rate;
+	uint8_t mode;
+	char *path;
+	/* Where the helper reports its start time, and its arguments */
+	int pipe_fd[2];
+	char fd_str[16];
+	struct storm_child *child;
+	uint64_t next_ns;
+
+	/* Statistics, within the measurement window */
+	uint64_t failed;
+	/* fork() duration, fork to child first run, execve() to helper main,
+	 * and fork to child exit collected */
+	struct sketch *fork;
+	struct sketch *first_run;
+	struct sketch *exec;
+	struct sketch *total;
+};
+
+static struct storm *storms = NULL;
+
+/*
+ * Activations schedule, i.e. the sequence of sleep and burst durations of a
+ * worker. It is generated from the worker seed, or replayed from a file
+ * with a "NAME SLEEP BURST" line per activation, in [us].
+ */
+struct schedule {
+	char name[16];
+	uint32_t count;
+	uint32_t next;
+	uint32_t capacity;
+	uint32_t *sleep_us;
+	uint32_t *burst_us;
+};
+
+static struct schedule *schedules = NULL;
+static uint32_t schedules_count = 0;
+static FILE *sched_fp = NULL;
+
+/* Durations of the next activation of a worker [us] */
+static void
+worker_activation(struct wdata *wdata, uint32_t *sleep_us, uint32_t *burst_us)
+{
+	struct schedule *sched = wdata->sched;
+	struct churn *churn;
+	uint32_t period;
+
+	/* Once the replayed schedule is over, continue from the seed */
+	if (sched && sched->next < sched->count) {
+		*sleep_us = sched->sleep_us[sched->next];
+		*burst_us = sched->burst_us[sched->next++];
+		return;
+	}
+
+	*sleep_us = *burst_us = 0;
+	switch (wdata->kind) {
+	case WORKER_INTERACTIVE:
+		*sleep_us = conf_rate ? exponential_random(wdata,
+				(double)S_TO_US / conf_rate)
+			: wdata->dist[0] ? dist_sample(wdata, wdata->dist[0])
+			: normal_random(wdata, wdata->params.interrupt.interval_max);
+		*burst_us = wdata->dist[1] ? dist_sample(wdata, wdata->dist[1])
+			: normal_random(wdata, wdata->params.interrupt.duration_max);
+		break;
+	case WORKER_PERIODC:
+		period = wdata->dist[0] ? dist_sample(wdata, wdata->dist[0])
+			: wdata->params.period.duration;
+		*burst_us = wdata->dist[1] ? dist_sample(wdata, wdata->dist[1])
+			: ( (float) period *
+			  ( (float) wdata->params.period.duty_cycle / 100.0) );
+		*sleep_us = (period > *burst_us) ? period - *burst_us : 0;
+		break;
+	case WORKER_YIELD:
+		*burst_us = wdata->dist[0] ? dist_sample(wdata, wdata->dist[0])
+			: wdata->params.yield.period;
+		break;
+	case WORKER_GRAPH:
+		*burst_us = normal_random(wdata, wdata->params.graph.dag
+				->nodes[wdata->params.graph.node].burst_us);
+		break;
+	case WORKER_EXEC:
+		period = wdata->params.exec.storm->rate;
+		*sleep_us = period ? S_TO_US / period : 0;
+		break;
+	case WORKER_THREAD:
+		churn = wdata->params.thread.churn;
+		*sleep_us = churn->rate ? S_TO_US / churn->rate : 0;
+		*burst_us = wdata->dist[0] ? dist_sample(wdata, wdata->dist[0])
+			: normal_random(wdata, churn->burst_us);
+		break;
+	}
+}
+
+static struct schedule *
+schedule_get(const char *name)
+{
+	struct schedule *sched;
+	uint32_t i;
+
+	for (i = 0; i < schedules_count; ++i)
+		if (!strcmp(schedules[i].name, name))
+			return schedules + i;
+
+	schedules = realloc(schedules,
+			(schedules_count + 1) * sizeof(struct schedule));
+	if (!schedules)
+		barf("realloc:");
+	sched = schedules + schedules_count++;
+	memset(sched, 0, sizeof(struct schedule));
+	snprintf(sched->name, sizeof(sched->name), "%s", name);
+
+	return sched;
+}
+
+/* Load the schedules to replay, and their seed unless one is given */
+static void
+schedule_load(void)
+{
+	struct schedule *sched;
+	uint32_t sleep_us, burst_us;
+	unsigned long long seed;
+	char line[128], name[16];
+	FILE *fp;
+
+	fp = fopen(conf_sched_replay, "r");
+	if (!fp) {
+		fprintf(stderr, FE("Cannot open schedule [%s]\n"), conf_sched_replay);
+		exit(-1);
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "# seed %llu", &seed) == 1) {
+			if (!conf_seed_set)
+				conf_seed = seed;
+			conf_seed_set = 1;
+			continue;
+		}
+		if (sscanf(line, "%15s %u %u", name, &sleep_us, &burst_us) < 3)
+			continue;
+
+		sched = schedule_get(name);
+		if (sched->count == sched->capacity) {
+			sched->capacity = sched->capacity ? 2 * sched->capacity : 1024;
+			sched->sleep_us = realloc(sched->sleep_us,
+					sched->capacity * sizeof(uint32_t));
+			sched->burst_us = realloc(sched->burst_us,
+					sched->capacity * sizeof(uint32_t));
+			if (!sched->sleep_us || !sched->burst_us)
+				barf("realloc:");
+		}
+		sched->sleep_us[sched->count] = sleep_us;
+		sched->burst_us[sched->count++] = burst_us;
+	}
+	fclose(fp);
+}
+
+/*
+ * Write the schedule of a worker, for the whole test duration, by running
+ * its generator on a copy of the worker data
+ */
+static void
+schedule_dump(struct wdata *wdata)
+{
+	uint64_t total_us = 0, test_us = (uint64_t)conf_td * S_TO_US;
+	uint32_t sleep_us, burst_us;
+	struct wdata copy;
+
+	if (!sched_fp)
+		return;
+	if (wdata->kind != WORKER_INTERACTIVE && wdata->kind != WORKER_PERIODC &&
+			wdata->kind != WORKER_YIELD && wdata->kind != WORKER_GRAPH)
+		return;
+
+	memcpy(&copy, wdata, sizeof(copy));
+	while (total_us < test_us) {
+		worker_activation(&copy, &sleep_us, &burst_us);
+		fprintf(sched_fp, "%s %u %u\n", wdata->name, sleep_us, burst_us);
+		if (wdata->kind == WORKER_GRAPH)
+			total_us += wdata->params.graph.dag->period_us;
+		else if (wdata->kind == WORKER_INTERACTIVE && conf_rate)
+			total_us += (uint64_t)sleep_us + 1;
+		else
+			total_us += (uint64_t)sleep_us + burst_us + 1;
+	}
+}
+
+/* Keep the CPU busy till end_ts */
+static void
+busy_until(struct wdata *wdata, struct timespec *end_ts)
+{
+	struct timespec now_ts;
+	uint64_t start_ns = timespec_now_ns();
+
+	log_event(wdata, start_ns, WLG_EV_START,
+		timespec_nanoseconds(end_ts) - start_ns);
+
+	while (1) {
+		clock_gettime(CLOCK_MONOTONIC_RAW, &now_ts);
+		//printf("Now processing @ ");
+		//timespec_print(&now_ts);
+		if (timespec_older(&now_ts , end_ts))
+			break;
+		occupancy_tick(wdata, timespec_nanoseconds(&now_ts));
+		busy_loop();
+	}
+
+	log_event(wdata, timespec_nanoseconds(&now_ts), WLG_EV_END,
+		timespec_nanoseconds(&now_ts) - start_ns);
+}
+
+/* Do the amount of work a reference CPU completes in us [us] */
+#define BUSY_WORK_CHUNK 4096
+
+static void
+busy_work(struct wdata *wdata, uint32_t us)
+{
+	uint64_t iterations = us * ref_iterations_per_us;
+	uint64_t start_ns, end_ns;
+	struct burst_stats *stats;
+	int cpu = sched_getcpu();
+
+	start_ns = timespec_now_ns();
+	log_event(wdata, start_ns, WLG_EV_START, (uint64_t)us * US_TO_NS);
+
+	for ( ; iterations > BUSY_WORK_CHUNK; iterations -= BUSY_WORK_CHUNK) {
+		if (conf_attr_us)
+			occupancy_tick(wdata, timespec_now_ns());
+		busy_spin(BUSY_WORK_CHUNK);
+	}
+	if (iterations)
+		busy_spin(iterations);
+
+	end_ns = timespec_now_ns();
+	log_event(wdata, end_ns, WLG_EV_END, end_ns - start_ns);
+
+	if (cpu < 0 || cpu >= cpus_count || !measuring(end_ns))
+		return;
+	stats = wdata->bursts + cpu;
+	++stats->count;
+	stats->ref_ns += (uint64_t)us * US_TO_NS;
+	stats->run_ns += end_ns - start_ns;
+}
+
+/* Run a processing burst of us [us], in reference CPU time if required */
+static void
+worker_burst(struct wdata *wdata, uint32_t us)
+{
+	uint64_t start_ns = timespec_now_ns();
+	struct timespec end_ts;
+	uint64_t end_ns;
+
+	if (conf_invariant) {
+		busy_work(wdata, us);
+	} else {
+		/* Configure processing end */
+		clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+		timespec_add_us(&end_ts, us);
+
+		//printf("End processing @ ");
+		//timespec_print(&end_ts);
+
+		busy_until(wdata, &end_ts);
+	}
+
+	end_ns = timespec_now_ns();
+	if (measuring(end_ns))
+		wdata->work_ns += end_ns - start_ns;
+}
+
+static void
+worker_batch(struct wdata *wdata)
+{
+	/* Dummy busy loop */
+	//DB(printf("%s loop\n", wdata->name));
+	busy_loop();
+	++wdata->loops;
+}
+
+static void
+worker_interactive(struct wdata *wdata)
+{
+	uint32_t delay, process;
+	struct timespec wake_ts;
+
+	/* Here we just need fast, and reproducible given the seed, random
+	 * numbers. We just need to introduce some variation on timings */
+
+	/* Setup next interrupt and processing time (uniform distribution) */
+	worker_activation(wdata, &delay, &process);
+	DB(printf(WD("sleeping for %9d [us]\n"), delay));
+	clock_gettime(CLOCK_MONOTONIC_RAW, &wake_ts);
+	timespec_add_us(&wake_ts, delay);
+	occupancy_stop(wdata);
+	pelt_update(wdata, timespec_now_ns(), PELT_SLEEPING);
+	worker_sleep(wdata, timespec_nanoseconds(&wake_ts));
+	worker_wakeup(wdata, &wake_ts);
+
+	DB(printf(WD("process  for %9d [us]\n"), process));
+	worker_burst(wdata, process);
+
+	++wdata->loops;
+}
+
+/*
+ * Open-loop INTERACTIVE workers: requests arrive at the offered rate, as a
+ * single stream, whatever the previous ones took to be served. Each worker
+ * claims the next request of the stream once done with its previous one,
+ * i.e. the workers serve a shared FIFO queue. When all of them are late the
+ * queued requests are served back to back, and the response time of a
+ * request accounts for its queueing too.
+ */
+static uint64_t requests_arrival_ns = 0;
+
+/* Claim the request arriving delay_us after the last claimed one */
+static uint64_t
+request_claim(uint32_t delay_us, uint64_t now_ns)
+{
+	uint64_t arrival_ns, next_ns;
+
+	arrival_ns = __atomic_load_n(&requests_arrival_ns, __ATOMIC_RELAXED);
+	do {
+		next_ns = (arrival_ns ? arrival_ns : now_ns)
+			+ (uint64_t)delay_us * US_TO_NS;
+	} while (!__atomic_compare_exchange_n(&requests_arrival_ns, &arrival_ns,
+			next_ns, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	return next_ns;
+}
+
+static void
+worker_request(struct wdata *wdata)
+{
+	uint32_t delay, process;
+	struct timespec wake_ts;
+	uint64_t now_ns;
+
+	worker_activation(wdata, &delay, &process);
+	now_ns = timespec_now_ns();
+	wdata->arrival_ns = request_claim(delay, now_ns);
+
+	if (now_ns < wdata->arrival_ns) {
+		DB(printf(WD("sleeping for %9llu [ns]\n"),
+			(unsigned long long)(wdata->arrival_ns - now_ns)));
+		wake_ts.tv_sec = wdata->arrival_ns / S_TO_NS;
+		wake_ts.tv_nsec = wdata->arrival_ns % S_TO_NS;
+		occupancy_stop(wdata);
+		pelt_update(wdata, now_ns, PELT_SLEEPING);
+		worker_sleep(wdata, wdata->arrival_ns);
+		worker_wakeup(wdata, &wake_ts);
+	}
+
+	DB(printf(WD("process  for %9d [us]\n"), process));
+	worker_burst(wdata, process);
+
+	now_ns = timespec_now_ns();
+	if (measuring(now_ns))
+		sketch_add(wdata->resp, now_ns - wdata->arrival_ns);
+
+	++wdata->loops;
+}
+
+/* Count the requests arrived by end_ns, and not claimed by any worker */
+static void
+worker_backlog(struct wdata *wdata, uint64_t end_ns)
+{
+	uint32_t delay, process;
+
+	for (;;) {
+		worker_activation(wdata, &delay, &process);
+		wdata->arrival_ns = request_claim(delay, end_ns);
+		if (wdata->arrival_ns > end_ns)
+			break;
+		++wdata->backlog;
+	}
+}
+
+static void
+worker_periodic(struct wdata *wdata)
+{
+	uint32_t sleep, process;
+	struct timespec wake_ts;
+
+	/* Setup next interrupt (uniform distribution) */
+	worker_activation(wdata, &sleep, &process);
+
+	DB(printf(WD("sleeping for %9d [us]\n"), sleep));
+	clock_gettime(CLOCK_MONOTONIC_RAW, &wake_ts);
+	timespec_add_us(&wake_ts, sleep);
+	occupancy_stop(wdata);
+	pelt_update(wdata, timespec_now_ns(), PELT_SLEEPING);
+	worker_sleep(wdata, timespec_nanoseconds(&wake_ts));
+	worker_wakeup(wdata, &wake_ts);
+
+	DB(printf(WD("process  for %9d [us]\n"), process));
+	worker_burst(wdata, process);
+
+	++wdata->loops;
+}
+
+static void
+worker_yield(struct wdata *wdata)
+{
+	uint32_t interval = wdata->params.yield.interval;
+	struct timespec now_ts, end_ts, yield_ts;
+	uint32_t period, sleep;
+
+	worker_activation(wdata, &sleep, &period);
+
+	/* Configure processing end */
+	clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+	timespec_add_us(&end_ts, period);
+
+	// Burst period
+	DB(printf(WD("burst  for %9d [us]\n"), period));
+	busy_until(wdata, &end_ts);
+
+	/* Configure yield end */
+	clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+	timespec_add_us(&end_ts, period);
+
+	/* Configure next yield time */
+	clock_gettime(CLOCK_MONOTONIC_RAW, &yield_ts);
+	DB(printf(WD("Sum first yield to @ ")));
+	DB(timespec_print(&yield_ts));
+	timespec_add_us(&yield_ts, interval);
+
+	// Yield period
+	DB(printf(WD("yield  for %9d [us]\n"), period));
+	DB(printf(WD("next yield @ ")));
+	DB(timespec_print(&yield_ts));
+	while (1) {
+		clock_gettime(CLOCK_MONOTONIC_RAW, &now_ts);
+		DB(printf(WD("Now processing @ ")));
+		DB(timespec_print(&now_ts));
+		if (timespec_older(&now_ts , &end_ts))
+			break;
+		occupancy_tick(wdata, timespec_nanoseconds(&now_ts));
+		// Yield if an interval has passed
+		if (timespec_older(&now_ts , &yield_ts)) {
+			timespec_add_us(&yield_ts, interval);
+			DB(printf(WD("YIELD, next yield @")));
+			DB(timespec_print(&yield_ts));
+			pthread_yield();
+		}
+	}
+
+	++wdata->loops;
+}
+
+static void
+worker_footprint(struct wdata *wdata)
+{
+	uint32_t mask = wdata->params.footprint.mask;
+	uint32_t x = wdata->params.footprint.state;
+	uint16_t i;
+
+	for (i = 0; i < FOOTPRINT_CALLS; ++i)
+		x = fp_funcs[x & mask](x);
+
+	wdata->params.footprint.state = x;
+	wdata->loops += FOOTPRINT_CALLS;
+}
+
+static void
+worker_mispredict(struct wdata *wdata)
+{
+	uint8_t *data = wdata->params.mispredict.data;
+	uint16_t threshold = wdata->params.mispredict.threshold;
+	uint32_t acc = 0;
+	uint32_t i;
+
+	for (i = 0; i < MISPREDICT_SIZE; ++i) {
+		if (data[i] < threshold) {
+			acc += i;
+			__asm__ __volatile__("" : "+r" (acc));
+		} else {
+			acc ^= i;
+			__asm__ __volatile__("" : "+r" (acc));
+		}
+	}
+
+	wdata->loops += MISPREDICT_SIZE;
+}
+
+static void
+worker_contention(struct wdata *wdata)
+{
+	uint64_t *counter = wdata->params.contention.counter;
+	uint64_t value;
+	uint16_t i;
+
+	switch (wdata->params.contention.op) {
+	case CONTENTION_OP_ADD:
+		for (i = 0; i < CONTENTION_OPS; ++i)
+			__atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+		break;
+	case CONTENTION_OP_CAS:
+		for (i = 0; i < CONTENTION_OPS; ++i) {
+			value = __atomic_load_n(counter, __ATOMIC_RELAXED);
+			while (!__atomic_compare_exchange_n(counter, &value,
+					value + 1, 1, __ATOMIC_RELAXED,
+					__ATOMIC_RELAXED));
+		}
+		break;
+	case CONTENTION_OP_STORE:
+		for (i = 0; i < CONTENTION_OPS; ++i)
+			*(volatile uint64_t *)counter = i;
+		break;
+	}
+
+	wdata->loops += CONTENTION_OPS;
+}
+
+static void
+worker_handoff(struct wdata *wdata)
+{
+	struct handoff *pair = wdata->params.handoff.pair;
+	uint8_t producer = wdata->params.handoff.producer;
+	struct timespec now_ts;
+	uint64_t sum = 0;
+	uint16_t spins;
+	uint32_t i;
+	uint8_t placement;
+
+	/* Wait for buffer ownership */
+	for (spins = 0; ; ++spins) {
+		if (__atomic_load_n(&pair->full, __ATOMIC_ACQUIRE) != producer)
+			break;
+		if (spins == HANDOFF_SPINS) {
+			/* Give a chance to check for the end of the test */
+			sched_yield();
+			return;
+		}
+	}
+
+	if (producer) {
+		for (i = 0; i < pair->words; ++i)
+			pair->buffer[i] = wdata->loops + i;
+		pair->cpu = sched_getcpu();
+		clock_gettime(CLOCK_MONOTONIC_RAW, &now_ts);
+		pair->handoff_ns = timespec_nanoseconds(&now_ts);
+		__atomic_store_n(&pair->full, 1, __ATOMIC_RELEASE);
+		++wdata->loops;
+		return;
+	}
+
+	for (i = 0; i < pair->words; ++i)
+		sum += pair->buffer[i];
+	clock_gettime(CLOCK_MONOTONIC_RAW, &now_ts);
+	if (measuring(timespec_nanoseconds(&now_ts))) {
+		placement = topology_placement(pair->cpu, sched_getcpu());
+		++wdata->handoff_count[placement];
+		wdata->handoff_ns[placement] +=
+			timespec_nanoseconds(&now_ts) - pair->handoff_ns;
+	}
+	/* Keep the reads from being optimized away */
+	pair->buffer[0] = sum;
+	__atomic_store_n(&pair->full, 0, __ATOMIC_RELEASE);
+	++wdata->loops;
+}
+
+/* A predecessor of node n completed the frame in slot */
+static void
+dag_signal(struct dag *dag, uint8_t n, uint32_t slot, uint64_t now_ns)
+{
+	struct dag_node *node = dag->nodes + n;
+
+	if (__atomic_sub_fetch(&node->remaining[slot], 1, __ATOMIC_ACQ_REL))
+		return;
+	node->ready_ns[slot] = now_ns;
+	sem_post(&node->ready);
+}
+
+/* A sink node completed the frame in slot */
+static void
+dag_sink(struct dag *dag, uint32_t slot, uint64_t now_ns)
+{
+	uint64_t lat_ns;
+
+	if (__atomic_sub_fetch(&dag->sinks_remaining[slot], 1, __ATOMIC_ACQ_REL))
+		return;
+
+	lat_ns = now_ns - dag->frame_start_ns[slot];
+	if (measuring(now_ns)) {
+		pthread_mutex_lock(&dag->stats_mtx);
+		sketch_add(dag->lat, lat_ns);
+		++dag->frames;
+		if (lat_ns > (uint64_t)dag->period_us * US_TO_NS)
+			++dag->janks;
+		pthread_mutex_unlock(&dag->stats_mtx);
+	}
+	__atomic_add_fetch(&dag->frames_done, 1, __ATOMIC_RELEASE);
+}
+
+/* Wait for the next vsync and start a frame, return its slot (-1: dropped) */
+static int32_t
+dag_vsync(struct wdata *wdata, struct dag *dag)
+{
+	struct dag_node *vsync = dag->nodes;
+	uint64_t period_ns = (uint64_t)dag->period_us * US_TO_NS;
+	uint64_t vsync_ns, now_ns, tick;
+	struct timespec wake_ts;
+	uint32_t slot;
+	uint8_t n;
+
+	now_ns = timespec_now_ns();
+	if (!dag->start_ns)
+		dag->start_ns = now_ns;
+
+	/* Vsyncs missed while running the previous frame drop their frames */
+	tick = (now_ns - dag->start_ns) / period_ns + 1;
+	if (tick < dag->next_vsync)
+		tick = dag->next_vsync;
+	if (dag->next_vsync && tick > dag->next_vsync && measuring(now_ns)) {
+		pthread_mutex_lock(&dag->stats_mtx);
+		dag->dropped += tick - dag->next_vsync;
+		pthread_mutex_unlock(&dag->stats_mtx);
+	}
+	dag->next_vsync = tick + 1;
+	vsync_ns = dag->start_ns + tick * period_ns;
+
+	wake_ts.tv_sec = vsync_ns / S_TO_NS;
+	wake_ts.tv_nsec = vsync_ns % S_TO_NS;
+	occupancy_stop(wdata);
+	pelt_update(wdata, now_ns, PELT_SLEEPING);
+	worker_sleep(wdata, vsync_ns);
+	worker_wakeup(wdata, &wake_ts);
+
+	/* Pipeline full: the slot of the new frame is still in use */
+	if (vsync->frame >= __atomic_load_n(&dag->frames_done, __ATOMIC_ACQUIRE)
+			+ DAG_FRAMES) {
+		if (measuring(vsync_ns)) {
+			pthread_mutex_lock(&dag->stats_mtx);
+			++dag->dropped;
+			pthread_mutex_unlock(&dag->stats_mtx);
+		}
+		return -1;
+	}
+
+	slot = vsync->frame++ % DAG_FRAMES;
+	dag->frame_start_ns[slot] = vsync_ns;
+	dag->sinks_remaining[slot] = dag->sinks_count;
+	for (n = 1; n < dag->nodes_count; ++n)
+		if (dag->nodes[n].source)
+			dag_signal(dag, n, slot, vsync_ns);
+
+	return slot;
+}
+
+/* Run a DAG node on a frame, once ready */
+static void
+worker_graph(struct wdata *wdata)
+{
+	struct dag *dag = wdata->params.graph.dag;
+	struct dag_node *node = dag->nodes + wdata->params.graph.node;
+	uint32_t sleep_us, burst_us;
+	struct timespec wake_ts;
+	uint64_t now_ns;
+	int32_t slot;
+	uint8_t n;
+
+	if (node == dag->nodes) {
+		slot = dag_vsync(wdata, dag);
+		if (slot < 0)
+			return;
+	} else {
+		occupancy_stop(wdata);
+		pelt_update(wdata, timespec_now_ns(), PELT_SLEEPING);
+		sem_wait(&node->ready);
+		if (dag->stop) {
+			/* Keep it released till the end of the test */
+			sem_post(&node->ready);
+			return;
+		}
+
+		/* Predecessors signal this slot again only after a full round */
+		slot = node->frame++ % DAG_FRAMES;
+		node->remaining[slot] = node->preds_count;
+		wake_ts.tv_sec = node->ready_ns[slot] / S_TO_NS;
+		wake_ts.tv_nsec = node->ready_ns[slot] % S_TO_NS;
+		worker_wakeup(wdata, &wake_ts);
+	}
+
+	worker_activation(wdata, &sleep_us, &burst_us);
+	worker_burst(wdata, burst_us);
+	++wdata->loops;
+
+	now_ns = timespec_now_ns();
+	for (n = 0; n < node->succs_count; ++n)
+		dag_signal(dag, node->succs[n], slot, now_ns);
+	if (node->sink)
+		dag_sink(dag, slot, now_ns);
+}
+
+/* Sleep till the next period of an audio thread, return its start time */
+static uint64_t
+audio_period(struct wdata *wdata, struct audio *path, uint64_t *tick)
+{
+	uint64_t period_ns = (uint64_t)path->period_us * US_TO_NS;
+	uint64_t start_ns = timespec_nanoseconds(&phase_ts);
+	uint64_t tick_ns, now_ns;
+	struct timespec wake_ts;
+
+	tick_ns = start_ns + ++*tick * period_ns;
+	wake_ts.tv_sec = tick_ns / S_TO_NS;
+	wake_ts.tv_nsec = tick_ns % S_TO_NS;
+
+	now_ns = timespec_now_ns();
+	occupancy_stop(wdata);
+	pelt_update(wdata, now_ns, PELT_SLEEPING);
+	worker_sleep(wdata, tick_ns);
+	worker_wakeup(wdata, &wake_ts);
+
+	return tick_ns;
+}
+
+static void
+worker_audio(struct wdata *wdata)
+{
+	struct audio *path = wdata->params.audio.path;
+	uint64_t tick_ns, now_ns, buffer, consumed;
+	uint32_t *samples, sum = 0;
+	uint32_t i;
+
+	if (wdata->params.audio.producer) {
+		tick_ns = audio_period(wdata, path, &path->producer_tick);
+
+		/* Buffers already played are useless, catch up */
+		consumed = __atomic_load_n(&path->consumed, __ATOMIC_ACQUIRE);
+		buffer = path->produced;
+		if (buffer < consumed)
+			buffer = consumed;
+		if (buffer >= consumed + path->ring_size) {
+			if (measuring(tick_ns))
+				++path->overruns;
+			return;
+		}
+
+		worker_burst(wdata, path->burst_us);
+		samples = path->ring + (buffer % path->ring_size) * AUDIO_SAMPLES;
+		for (i = 0; i < AUDIO_SAMPLES; ++i)
+			samples[i] = wdata->loops + i;
+		__atomic_store_n(&path->produced, buffer + 1, __ATOMIC_RELEASE);
+		++wdata->loops;
+
+		now_ns = timespec_now_ns();
+		tick_ns += (uint64_t)path->burst_us * US_TO_NS;
+		if (measuring(now_ns))
+			sketch_add(path->late, now_ns > tick_ns ? now_ns - tick_ns : 0);
+		return;
+	}
+
+	/* The first buffer is played once the ring is full, but for a buffer */
+	if (!path->consumer_tick)
+		path->consumer_tick = path->ring_size - 1;
+	tick_ns = audio_period(wdata, path, &path->consumer_tick);
+
+	buffer = path->consumed;
+	if (__atomic_load_n(&path->produced, __ATOMIC_ACQUIRE) > buffer) {
+		samples = path->ring + (buffer % path->ring_size) * AUDIO_SAMPLES;
+		for (i = 0; i < AUDIO_SAMPLES; ++i)
+			sum += samples[i];
+		/* Keep the reads from being optimized away */
+		samples[0] = sum;
+		++wdata->loops;
+		if (measuring(tick_ns))
+			++path->buffers;
+	} else if (measuring(tick_ns)) {
+		++path->underruns;
+	}
+	__atomic_store_n(&path->consumed, buffer + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Sleep till the next of a series of events at a fixed rate, i.e. delay_us
+ * since the previous one, unless already late
+ */
+static void
+worker_pace(struct wdata *wdata, uint64_t *next_ns, uint32_t delay_us)
+{
+	struct timespec wake_ts;
+	uint64_t now_ns = timespec_now_ns();
+
+	if (!*next_ns)
+		*next_ns = now_ns;
+	*next_ns += (uint64_t)delay_us * US_TO_NS;
+	if (now_ns >= *next_ns)
+		return;
+
+	wake_ts.tv_sec = *next_ns / S_TO_NS;
+	wake_ts.tv_nsec = *next_ns % S_TO_NS;
+	occupancy_stop(wdata);
+	pelt_update(wdata, now_ns, PELT_SLEEPING);
+	worker_sleep(wdata, *next_ns);
+	worker_wakeup(wdata, &wake_ts);
+}
+
+static void *
+churn_thread(void *arg)
+{
+	struct churn_slot *slot = arg;
+	uint64_t end_ns;
+
+	slot->run_ns = timespec_now_ns();
+	end_ns = slot->run_ns + (uint64_t)slot->burst_us * US_TO_NS;
+	while (timespec_now_ns() < end_ns)
+		busy_loop();
+	slot->exit_ns = timespec_now_ns();
+
+	/* The slot can be reused as soon as this is visible */
+	__atomic_store_n(&slot->state, CHURN_DONE, __ATOMIC_RELEASE);
+
+	return NULL;
+}
+
+/* Account the threads which exited, and free their slots */
+static int32_t
+churn_reap(struct churn *churn)
+{
+	struct churn_slot *slot;
+	int32_t free_slot = -1;
+	uint16_t i;
+
+	for (i = 0; i < churn->concurrency; ++i) {
+		slot = churn->slots + i;
+		switch (__atomic_load_n(&slot->state, __ATOMIC_ACQUIRE)) {
+		case CHURN_DONE:
+			if (measuring(slot->exit_ns)) {
+				sketch_add(churn->first_run,
+					slot->run_ns - slot->spawn_ns);
+				sketch_add(churn->lifetime,
+					slot->exit_ns - slot->run_ns);
+			}
+			slot->state = CHURN_FREE;
+			/* fall through */
+		case CHURN_FREE:
+			free_slot = i;
+			break;
+		}
+	}
+
+	return free_slot;
+}
+
+static void
+worker_thread(struct wdata *wdata)
+{
+	struct churn *churn = wdata->params.thread.churn;
+	uint32_t delay, burst;
+	struct churn_slot *slot;
+	uint64_t now_ns, end_ns;
+	int32_t free_slot;
+	pthread_t thread;
+	int err;
+
+	worker_activation(wdata, &delay, &burst);
+
+	/* Spawn at a fixed rate, whatever the previous threads took */
+	if (churn->rate)
+		worker_pace(wdata, &churn->next_ns, delay);
+	now_ns = timespec_now_ns();
+
+	free_slot = churn_reap(churn);
+	if (free_slot < 0) {
+		/* Too many threads alive: a spawn missed, or wait for one */
+		if (churn->rate && measuring(now_ns))
+			++churn->missed;
+		if (!churn->rate)
+			sched_yield();
+		return;
+	}
+
+	slot = churn->slots + free_slot;
+	slot->burst_us = burst;
+	slot->state = CHURN_RUNNING;
+	slot->spawn_ns = timespec_now_ns();
+	err = pthread_create(&thread, &churn->attr, churn_thread, slot);
+	end_ns = timespec_now_ns();
+	if (err) {
+		slot->state = CHURN_FREE;
+		if (measuring(end_ns))
+			++churn->failed;
+		return;
+	}
+
+	if (measuring(end_ns))
+		sketch_add(churn->spawn, end_ns - slot->spawn_ns);
+	++wdata->loops;
+}
+
+/* Wait for the threads still alive, which use the worker data */
+static void
+churn_drain(struct churn *churn)
+{
+	uint16_t i;
+
+	for (i = 0; i < churn->concurrency; ++i)
+		while (__atomic_load_n(&churn->slots[i].state,
+				__ATOMIC_ACQUIRE) == CHURN_RUNNING)
+			usleep(100);
+	churn_reap(churn);
+	churn->next_ns = 0;
+}
+
+/* Minimal exec target: report when it started running, and exit */
+static int
+exec_helper(const char *fd_str)
+{
+	uint64_t now_ns = timespec_now_ns();
+	int fd = atoi(fd_str);
+
+	if (write(fd, &now_ns, sizeof(now_ns)) != sizeof(now_ns))
+		return 1;
+
+	return 0;
+}
+
+static void
+worker_exec(struct wdata *wdata)
+{
+	struct storm *storm = wdata->params.exec.storm;
+	char *argv[] = { "wlg", "--exec-helper", storm->fd_str, NULL };
+	uint64_t start_ns, fork_ns, end_ns, helper_ns = 0;
+	uint32_t delay, burst;
+	pid_t child;
+	int status;
+
+	worker_activation(wdata, &delay, &burst);
+	if (storm->rate)
+		worker_pace(wdata, &storm->next_ns, delay);
+
+	storm->child->run_ns = 0;
+	storm->child->exec_ns = 0;
+	start_ns = timespec_now_ns();
+	child = fork();
+	if (!child) {
+		/* Only async-signal-safe calls from here on */
+		storm->child->run_ns = timespec_now_ns();
+		if (storm->mode == STORM_FORK)
+			_exit(0);
+		storm->child->exec_ns = timespec_now_ns();
+		if (storm->mode == STORM_SELF)
+			execv("/proc/self/exe", argv);
+		else
+			execl(storm->path, storm->path, (char *)NULL);
+		_exit(127);
+	}
+	fork_ns = timespec_now_ns();
+	if (child < 0) {
+		if (measuring(fork_ns))
+			++storm->failed;
+		return;
+	}
+
+	occupancy_stop(wdata);
+	if (waitpid(child, &status, 0) < 0)
+		barf("waitpid:");
+	end_ns = timespec_now_ns();
+	occupancy_tick(wdata, end_ns);
+	if (storm->mode == STORM_SELF && read(storm->pipe_fd[0], &helper_ns,
+			sizeof(helper_ns)) != sizeof(helper_ns))
+		helper_ns = 0;
+
+	++wdata->loops;
+	if (!measuring(end_ns))
+		return;
+	if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+		++storm->failed;
+		return;
+	}
+	sketch_add(storm->fork, fork_ns - start_ns);
+	if (storm->child->run_ns)
+		sketch_add(storm->first_run, storm->child->run_ns - start_ns);
+	if (helper_ns > storm->child->exec_ns && storm->child->exec_ns)
+		sketch_add(storm->exec, helper_ns - storm->child->exec_ns);
+	sketch_add(storm->total, end_ns - start_ns);
+}
+
+/* Release all the nodes waiting for a frame, at the end of the test */
+static void
+dag_stop(struct dag *dag)
+{
+	uint8_t n;
+
+	dag->stop = 1;
+	for (n = 1; n < dag->nodes_count; ++n)
+		sem_post(&dag->nodes[n].ready);
+}
+
+/* Track the worker loops within the measurement window */
+static void
+window_update(struct wdata *wdata, uint64_t now_ns)
+{
+	if (!wdata->win_start_ns) {
+		if (!measuring(now_ns))
+			return;
+		wdata->win_start_ns = now_ns;
+		wdata->win_loops = wdata->loops;
+		wdata->win_cpu_ns = timespec_thread_ns();
+		return;
+	}
+
+	if (wdata->run_ns || now_ns < meas_end_ns)
+		return;
+	wdata->run_ns = now_ns - wdata->win_start_ns;
+	wdata->win_loops = wdata->loops - wdata->win_loops;
+	wdata->win_cpu_ns = timespec_thread_ns() - wdata->win_cpu_ns;
+}
+
+/* Run the workload for a phase of the test */
+static void
+worker_phase(struct wdata *wdata)
+{
+	struct timespec now_ts;
+	struct timespec end_ts;
+	uint64_t now_ns;
+
+	pelt_update(wdata, timespec_now_ns(), PELT_RUNNING);
+
+	/* Setup worker termination time */
+	end_ts = phase_ts;
+	end_ts.tv_sec += conf_td;
+
+	while (1) {
+
+		/* Check end of test */
+		clock_gettime(CLOCK_MONOTONIC_RAW, &now_ts);
+		now_ns = timespec_nanoseconds(&now_ts);
+		if (timespec_older(&now_ts, &end_ts))
+			break;
+		occupancy_tick(wdata, now_ns);
+		window_update(wdata, now_ns);
+
+		/* Do workload */
+		switch (wdata->kind) {
+		case WORKER_BATCH:
+			worker_batch(wdata);
+			break;
+		case WORKER_INTERACTIVE:
+			if (conf_rate)
+				worker_request(wdata);
+			else
+				worker_interactive(wdata);
+			break;
+		case WORKER_PERIODC:
+			worker_periodic(wdata);
+			break;
+		case WORKER_YIELD:
+			worker_yield(wdata);
+			break;
+		case WORKER_FOOTPRINT:
+			worker_footprint(wdata);
+			break;
+		case WORKER_MISPREDICT:
+			worker_mispredict(wdata);
+			break;
+		case WORKER_CONTENTION:
+			worker_contention(wdata);
+			break;
+		case WORKER_HANDOFF:
+			worker_handoff(wdata);
+			break;
+		case WORKER_GRAPH:
+			worker_graph(wdata);
+			break;
+		case WORKER_AUDIO:
+			worker_audio(wdata);
+			break;
+		case WORKER_THREAD:
+			worker_thread(wdata);
+			break;
+		case WORKER_EXEC:
+			worker_exec(wdata);
+			break;
+		}
+
+	}
+
+	occupancy_stop(wdata);
+	pelt_update(wdata, timespec_now_ns(), PELT_SLEEPING);
+	if (wdata->resp)
+		worker_backlog(wdata, now_ns);
+	if (wdata->kind == WORKER_THREAD)
+		churn_drain(wdata->params.thread.churn);
+	if (wdata->kind == WORKER_GRAPH && !wdata->params.graph.node)
+		dag_stop(wdata->params.graph.dag);
+
+	/* Close the measurement window, if still open */
+	if (wdata->win_start_ns && !wdata->run_ns) {
+		wdata->run_ns = now_ns - wdata->win_start_ns;
+		wdata->win_loops = wdata->loops - wdata->win_loops;
+		wdata->win_cpu_ns = timespec_thread_ns() - wdata->win_cpu_ns;
+	}
+	wdata->loops = wdata->run_ns ? wdata->win_loops : 0;
+}
+
+static void *
+worker(void *conf)
+{
+	struct wdata *wdata = (struct wdata*) conf;
+	uint32_t phase;
+	uint32_t i;
+
+	wdata->pid = gettid();
+
+	/* Setup worker affinity */
+	if (wdata->cpu >= 0) {
+		cpu_set_t cpuset;
+
+		CPU_ZERO(&cpuset);
+		CPU_SET(wdata->cpu, &cpuset);
+		if (sched_setaffinity(0, sizeof(cpuset), &cpuset))
+			barf("sched_setaffinity:");
+	}
+
+	wdata->lat = sketch_new();
+	sleep_setup(wdata);
+	if (wdata->kind == WORKER_INTERACTIVE && conf_rate)
+		wdata->resp = sketch_new();
+	attribution_setup(wdata);
+	if (conf_invariant) {
+		wdata->bursts = calloc(cpus_count, sizeof(struct burst_stats));
+		if (!wdata->bursts)
+			barf("calloc:");
+	}
+
+	/* Setup kind specific data */
+	switch (wdata->kind) {
+	case WORKER_FOOTPRINT:
+		wdata->params.footprint.state = worker_random(wdata);
+		break;
+	case WORKER_MISPREDICT:
+		wdata->params.mispredict.data = malloc(MISPREDICT_SIZE);
+		if (!wdata->params.mispredict.data)
+			barf("malloc:");
+		for (i = 0; i < MISPREDICT_SIZE; ++i)
+			wdata->params.mispredict.data[i] = worker_random(wdata);
+		break;
+	}
+
+	prctl(PR_SET_NAME, wdata->name, NULL, NULL, NULL);
+	DB(printf(WD("worker created\n")));
+	log_open(wdata);
+
+	for (phase = 0; phase < conf_phases; ++phase) {
+		sync_start(wdata);
+		if (!phase)
+			log_start(wdata);
+		worker_phase(wdata);
+		sync_end(wdata);
+	}
+	log_close(wdata);
+
+	if (wdata->sleep_fd >= 0)
+		close(wdata->sleep_fd);
+	if (wdata->kind == WORKER_MISPREDICT)
+		free(wdata->params.mispredict.data);
+
+	DB(printf(WD("terminated\n")));
+
+	return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Capacity calibration
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * The reference kernel, i.e. busy_loop(), is run pinned on each online CPU
+ * and its throughput is compared with the one of the fastest CPU. A warmup
+ * run gives the cpufreq governor a chance to ramp up the frequency.
+ * Results are cached in a file, since they depend on the platform only.
+ */
+#define CALIB_WARMUP_MS 100
+#define CALIB_RUN_MS    250
+
+static double
+calibrate_cpu(int cpu)
+{
+	cpu_set_t cpuset;
+	uint64_t start_ns, now_ns, loops = 0;
+
+	CPU_ZERO(&cpuset);
+	CPU_SET(cpu, &cpuset);
+	if (sched_setaffinity(0, sizeof(cpuset), &cpuset))
+		return 0;
+
+	start_ns = timespec_now_ns();
+	while (timespec_now_ns() - start_ns < CALIB_WARMUP_MS * MS_TO_NS)
+		busy_loop();
+
+	start_ns = timespec_now_ns();
+	do {
+		busy_loop();
+		++loops;
+		now_ns = timespec_now_ns();
+	} while (now_ns - start_ns < CALIB_RUN_MS * MS_TO_NS);
+
+	return (double)loops * S_TO_NS / (now_ns - start_ns);
+}
+
+static void
+calibration_print(void)
+{
+	int cpu;
+
+	printf(FI("CPUs capacity:\n"));
+	printf(FI("  CPU  loops/s    capacity  sysfs capacity\n"));
+	for (cpu = 0; cpu < cpus_count; ++cpu) {
+		if (!cpus_topology[cpu].loops_per_s)
+			continue;
+		printf(FI("  %3d %10.1f %8ld %14ld\n"), cpu,
+			cpus_topology[cpu].loops_per_s,
+			cpus_topology[cpu].capacity,
+			cpus_topology[cpu].sysfs_capacity);
+	}
+}
+
+static void
+calibration_run(void)
+{
+	cpu_set_t cpuset;
+	double max = 0;
+	FILE *fp;
+	int cpu;
+
+	/* Restore the original affinity at the end */
+	if (sched_getaffinity(0, sizeof(cpuset), &cpuset))
+		barf("sched_getaffinity:");
+
+	printf(FI("Calibrating CPUs capacity...\n"));
+	for (cpu = 0; cpu < cpus_count; ++cpu) {
+		if (!cpus_topology[cpu].online)
+			continue;
+		cpus_topology[cpu].loops_per_s = calibrate_cpu(cpu);
+		if (cpus_topology[cpu].loops_per_s > max)
+			max = cpus_topology[cpu].loops_per_s;
+	}
+	sched_setaffinity(0, sizeof(cpuset), &cpuset);
+	if (!max) {
+		fprintf(stderr, FE("Cannot calibrate any CPU\n"));
+		exit(-1);
+	}
+
+	for (cpu = 0; cpu < cpus_count; ++cpu)
+		cpus_topology[cpu].capacity =
+			1024 * cpus_topology[cpu].loops_per_s / max + 0.5;
+
+	fp = fopen(conf_calib_file, "w");
+	if (!fp) {
+		fprintf(stderr, FE("Cannot write calibration file [%s]\n"),
+			conf_calib_file);
+		return;
+	}
+	fprintf(fp, "# wlg calibration: cpu loops/s capacity sysfs_capacity\n");
+	fprintf(fp, "# cpus %d\n", cpus_count);
+	for (cpu = 0; cpu < cpus_count; ++cpu) {
+		if (!cpus_topology[cpu].loops_per_s)
+			continue;
+		fprintf(fp, "%d %f %ld %ld\n", cpu,
+			cpus_topology[cpu].loops_per_s,
+			cpus_topology[cpu].capacity,
+			cpus_topology[cpu].sysfs_capacity);
+	}
+	fclose(fp);
+}
+
+/* Load cached calibration results, return 0 on success */
+static int
+calibration_load(void)
+{
+	char line[128];
+	double loops_per_s;
+	long capacity, sysfs_capacity;
+	int cpu, count = 0, cpus = -1, stale = 0;
+	FILE *fp;
+
+	fp = fopen(conf_calib_file, "r");
+	if (!fp)
+		return -1;
+
+	/* Results of another platform, or topology, are not valid here */
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "# cpus %d", &cpus) == 1)
+			continue;
+		if (sscanf(line, "%d %lf %ld %ld", &cpu, &loops_per_s,
+				&capacity, &sysfs_capacity) != 4)
+			continue;
+		if (cpu < 0 || cpu >= cpus_count ||
+				sysfs_capacity != cpus_topology[cpu].sysfs_capacity) {
+			stale = 1;
+			break;
+		}
+		cpus_topology[cpu].loops_per_s = loops_per_s;
+		cpus_topology[cpu].capacity = capacity;
+		++count;
+	}
+	fclose(fp);
+
+	if (stale || cpus != cpus_count) {
+		fprintf(stderr, FE("Ignoring calibration file [%s] (not matching the CPUs topology)\n"),
+			conf_calib_file);
+		for (cpu = 0; cpu < cpus_count; ++cpu) {
+			cpus_topology[cpu].loops_per_s = 0;
+			cpus_topology[cpu].capacity = 0;
+		}
+		return -1;
+	}
+
+	return count ? 0 : -1;
+}
+
+/* Setup the reference CPU speed, i.e. the fastest calibrated CPU */
+static void
+calibration_setup(void)
+{
+	double max = 0;
+	int cpu;
+
+	for (cpu = 0; cpu < cpus_count; ++cpu)
+		if (cpus_topology[cpu].loops_per_s > max)
+			max = cpus_topology[cpu].loops_per_s;
+	if (max == 0) {
+		printf(FI("No CPUs capacity calibration found, running it..\n"));
+		calibration_run();
+		calibration_print();
+		calibration_setup();
+		return;
+	}
+
+	ref_iterations_per_us = max * BUSY_LOOP_ITERATIONS / S_TO_US;
+	printf(FI("Reference CPU speed: %.1f [loops/s]\n"), max);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Setup workload
+////////////////////////////////////////////////////////////////////////////////
+
+/* Long only options */
+enum {
+	OPT_ATTR_THRESHOLD = 256,
+	OPT_ATTR_RECORDS,
+	OPT_LOG,
+	OPT_TRIALS,
+	OPT_TRIALS_WARMUP,
+	OPT_COMPARE,
+	OPT_METRICS_FD,
+	OPT_WARMUP,
+	OPT_COOLDOWN,
+	OPT_CALIB_FILE,
+	OPT_SAMPLE,
+	OPT_POWER_MODEL,
+	OPT_PELT,
+	OPT_PELT_FILE,
+	OPT_SEED,
+	OPT_SCHED_DUMP,
+	OPT_SCHED_REPLAY,
+	OPT_SWEEP,
+	OPT_SWEEP_POINT,
+	OPT_PROBE,
+	OPT_RATE,
+	OPT_RATE_SWEEP,
+	OPT_PHASES,
+	OPT_PHASE,
+	OPT_SLEEP,
+	OPT_SPIN_MARGIN,
+};
+
+static char *opts = "a:b:c:d:e:f:g:hi:m:p:t:x:y:";
+static struct option long_options[] =
+{
+	{"audio",    required_argument, 0, 'a'},
+	{"batch",    required_argument, 0, 'b'},
+	{"contention", required_argument, 0, 'c'},
+	{"duration", required_argument, 0, 'd'},
+	{"exec",     required_argument, 0, 'e'},
+	{"footprint", required_argument, 0, 'f'},
+	{"graph",    required_argument, 0, 'g'},
+	{"help",     no_argument,       0, 'h'},
+	{"intrrupt", required_argument, 0, 'i'},
+	{"mispredict", required_argument, 0, 'm'},
+	{"process",  required_argument, 0, 'p'},
+	{"thread",   required_argument, 0, 't'},
+	{"verbose",  no_argument,       &conf_vr, 1},
+	{"attr-threshold", required_argument, 0, OPT_ATTR_THRESHOLD},
+	{"attr-records", required_argument, 0, OPT_ATTR_RECORDS},
+	{"log",      required_argument, 0, OPT_LOG},
+	{"trials",   required_argument, 0, OPT_TRIALS},
+	{"trials-warmup", required_argument, 0, OPT_TRIALS_WARMUP},
+	{"compare",  required_argument, 0, OPT_COMPARE},
+	{"metrics-fd", required_argument, 0, OPT_METRICS_FD},
+	{"warmup",   required_argument, 0, OPT_WARMUP},
+	{"cooldown", required_argument, 0, OPT_COOLDOWN},
+	{"calibrate", no_argument,      &conf_calibrate, 1},
+	{"calib-file", required_argument, 0, OPT_CALIB_FILE},
+	{"invariant", no_argument,      &conf_invariant, 1},
+	{"sample",   required_argument, 0, OPT_SAMPLE},
+	{"power-model", required_argument, 0, OPT_POWER_MODEL},
+	{"pelt",     required_argument, 0, OPT_PELT},
+	{"pelt-file", required_argument, 0, OPT_PELT_FILE},
+	{"seed",     required_argument, 0, OPT_SEED},
+	{"schedule-dump", required_argument, 0, OPT_SCHED_DUMP},
+	{"schedule", required_argument, 0, OPT_SCHED_REPLAY},
+	{"sweep",    required_argument, 0, OPT_SWEEP},
+	{"sweep-point", required_argument, 0, OPT_SWEEP_POINT},
+	{"probe",    required_argument, 0, OPT_PROBE},
+	{"rate",     required_argument, 0, OPT_RATE},
+	{"rate-sweep", required_argument, 0, OPT_RATE_SWEEP},
+	{"phases",   required_argument, 0, OPT_PHASES},
+	{"phase",    required_argument, 0, OPT_PHASE},
+	{"pool",     no_argument,       &conf_pool, 1},
+	{"sleep",    required_argument, 0, OPT_SLEEP},
+	{"spin-margin", required_argument, 0, OPT_SPIN_MARGIN},
+	{"handoff",  required_argument, 0, 'x'},
+	{"yield",    required_argument, 0, 'y'},
+	{0, 0, 0, 0}
+};
+
+static void
+print_usage(char *prog)
+{
+	fprintf(stderr, " \n");
+	fprintf(stderr, "Usage: %s <options> <workload>\n", prog);
+	fprintf(stderr, " \n");
+	fprintf(stderr, " <options>:\n");
+	fprintf(stderr, "   -d, --duration - test duration in [s], or with a m, h or d suffix (default: 5)\n");
+	fprintf(stderr, "   --verbose      - enable verbose output\n");
+	fprintf(stderr, "   --phases N     - run the workload N times, each one for the test\n");
+	fprintf(stderr, "                    duration, with the same workers parked in between\n");
+	fprintf(stderr, "   --phase P:K,A,B[,A,B..] - from phase P on, the K workers (i, p or y)\n");
+	fprintf(stderr, "                    run with the A,B parameters of their -K option, in\n");
+	fprintf(stderr, "                    [us] (the last pair for the remaining workers)\n");
+	fprintf(stderr, "   --warmup MS    - do not account statistics in the first MS [ms]\n");
+	fprintf(stderr, "   --cooldown MS  - do not account statistics in the last MS [ms]\n");
+	fprintf(stderr, "   --calibrate    - measure the capacity of each CPU and cache it\n");
+	fprintf(stderr, "   --calib-file F - CPUs capacity cache file (default: wlg.calib)\n");
+	fprintf(stderr, "   --sample MS    - sample CPUs frequency every MS [ms], and report\n");
+	fprintf(stderr, "                    frequencies and idle states residency, thermal\n");
+	fprintf(stderr, "                    zones temperatures and throttling intervals\n");
+	fprintf(stderr, "   --power-model F - estimate energy from the CPUs power model F\n");
+	fprintf(stderr, "                    (implies --sample 10, if not specified)\n");
+	fprintf(stderr, "   --pelt MS      - every MS [ms], dump PELT signals estimated from\n");
+	fprintf(stderr, "                    workers activity and, when available, the\n");
+	fprintf(stderr, "                    kernel ones (util_avg, load_avg, runnable_avg)\n");
+	fprintf(stderr, "   --pelt-file F  - load tracking CSV file (default: wlg_pelt.csv)\n");
+	fprintf(stderr, "   --seed S       - master random seed, workers activations are the\n");
+	fprintf(stderr, "                    same on every run with the same seed\n");
+	fprintf(stderr, "                    (default: a new one, reported)\n");
+	fprintf(stderr, "   --schedule-dump F - write the activations of I, P, Y and G workers\n");
+	fprintf(stderr, "                    for the whole test into F\n");
+	fprintf(stderr, "   --schedule F   - replay the activations written by --schedule-dump\n");
+	fprintf(stderr, "   --invariant    - I and P bursts are amounts of work, in [us] of the\n");
+	fprintf(stderr, "                    fastest calibrated CPU, instead of wall time\n");
+	fprintf(stderr, "   --attr-threshold US - attribute wakeup latencies above US [us]\n");
+	fprintf(stderr, "                    to the workers running on the same CPU\n");
+	fprintf(stderr, "   --attr-records N - CPU occupancy records kept per worker (default: 4096)\n");
+	fprintf(stderr, "   --log DIR      - write per-worker binary events logs into DIR\n");
+	fprintf(stderr, "                    (to be processed by wlg-analyze)\n");
+	fprintf(stderr, "   --trials K     - run the workload K times, each one in a new process,\n");
+	fprintf(stderr, "                    and report metrics with their 95%% confidence intervals\n");
+	fprintf(stderr, "   --trials-warmup W - discard the first W trials (default: 1)\n");
+	fprintf(stderr, "   --pool         - run the trials as phases of the same workers\n");
+	fprintf(stderr, "   --compare \"B\" - interleave trials with the B options (e.g. \"-d5 -b2\")\n");
+	fprintf(stderr, "                    and test the significance of the differences\n");
+	fprintf(stderr, "   --sweep K[:F]  - run the workload once per count of the K workers\n");
+	fprintf(stderr, "                    (b, i, p, y, f, m, c, x, a, t or e), from 1 up to F\n");
+	fprintf(stderr, "                    times the online CPUs (default: 2), and report their\n");
+	fprintf(stderr, "                    throughput, fairness and the probe latency\n");
+	fprintf(stderr, "   --rate R       - I workers serve R [requests/s] overall, arriving as\n");
+	fprintf(stderr, "                    a Poisson process (open-loop) rather than every\n");
+	fprintf(stderr, "                    I [us], from a queue shared by all of them, and\n");
+	fprintf(stderr, "                    report their response times\n");
+	fprintf(stderr, "   --rate-sweep R,S,SLO - run the workload once per --rate, from R up by\n");
+	fprintf(stderr, "                    S [requests/s], until the response times p99\n");
+	fprintf(stderr, "                    exceeds SLO [us], and report the maximum rate\n");
+	fprintf(stderr, "   --probe US     - spawn a light PERIODIC worker (wlg_P000), every US\n");
+	fprintf(stderr, "                    [us], and report its wakeup latency\n");
+	fprintf(stderr, "   --sleep M[:S][,M[:S]..] - workers sleep by means of M, with a timer\n");
+	fprintf(stderr, "                    slack of S [ns] (default: usleep, and the default\n");
+	fprintf(stderr, "                    slack), assigned round robin to the workers of each\n");
+	fprintf(stderr, "                    kind, and report how much they oversleep. M is one of\n");
+	fprintf(stderr, "                    usleep, nanosleep, absolute (clock_nanosleep), timerfd,\n");
+	fprintf(stderr, "                    futex, epoll, poll or hybrid (absolute, and spinning\n");
+	fprintf(stderr, "                    for the last --spin-margin, default: %d [us])\n",
+		SLEEP_SPIN_MARGIN_US);
+	fprintf(stderr, "   --spin-margin US - I and P workers sleep until US [us] before their\n");
+	fprintf(stderr, "                    deadlines, and spin for the rest, and report the\n");
+	fprintf(stderr, "                    time spun apart from the time running bursts\n");
+	fprintf(stderr, " \n");
+	fprintf(stderr, " <workload>:\n");
+	fprintf(stderr, "   -b N - spawn N BATCH threads\n");
+	fprintf(stderr, "   -i N,[<I,D>] - spawn N INTERACTIVE tasks with the specified execution model:\n");
+	fprintf(stderr, "            start (at least) once every I [us]\n");
+	fprintf(stderr, "            run for up to D [us]\n");
+	fprintf(stderr, "     I and D are upper bounds for normally distributed actual values\n");
+	fprintf(stderr, "   -p N,[<P,D>] - spawn N PERIODC tasks with the specified execution model:\n");
+	fprintf(stderr, "            period duration of P [us]\n");
+	fprintf(stderr, "            running duty-cycle of D [us]\n");
+	fprintf(stderr, "   -y N,[<P,I>] - spawn N YIELD tasks with the specified execution model:\n");
+	fprintf(stderr, "            burst/yield period duration of P [us]\n");
+	fprintf(stderr, "            yielding interval of I [us] (during the yield period)\n");
+	fprintf(stderr, "     I, D and P can be @FILE, i.e. an empirical CDF of durations in [us] with\n");
+	fprintf(stderr, "     a \"VALUE P\" line per point, in which case PERIODIC D is a duration in [us]\n");
+	fprintf(stderr, "   -f N,[<F>] - spawn N FOOTPRINT tasks with the specified execution model:\n");
+	fprintf(stderr, "            call F distinct functions in a data dependent order\n");
+	fprintf(stderr, "            (F is rounded down to a power of two, max %d)\n", FOOTPRINT_FUNCS);
+	fprintf(stderr, "   -m N,[<T>] - spawn N MISPREDICT tasks with the specified execution model:\n");
+	fprintf(stderr, "            take a branch driven by random data with a T [%%] probability\n");
+	fprintf(stderr, "            (T=50 is the most unpredictable, T=0 or T=100 never mispredict)\n");
+	fprintf(stderr, "   -c N,L,O - spawn N CONTENTION tasks updating their own shared counter:\n");
+	fprintf(stderr, "            counters layout L: 0 same cache line, 1 adjacent lines, 2 padded\n");
+	fprintf(stderr, "            operation O: 0 atomic add, 1 CAS loop, 2 plain store\n");
+	fprintf(stderr, "   -x N,S[,P,C] - spawn N HANDOFF pairs of tasks passing a buffer to each other:\n");
+	fprintf(stderr, "            buffer size of S [bytes]\n");
+	fprintf(stderr, "            producers pinned on CPU P, consumers pinned on CPU C (default: not pinned)\n");
+	fprintf(stderr, "   -g N,F,<B[:D[+D..]]>.. - spawn a GRAPH of N tasks, i.e. a frames pipeline:\n");
+	fprintf(stderr, "            a new frame every F [us], with a deadline of F [us]\n");
+	fprintf(stderr, "            each task runs for up to B [us] (normally distributed) once\n");
+	fprintf(stderr, "            the tasks D (1-based, preceding it) completed the frame\n");
+	fprintf(stderr, "            the first task has no dependencies, and starts the frames\n");
+	fprintf(stderr, "            (e.g. -g4,16666,2000,4000:1,8000:2,3000:3)\n");
+	fprintf(stderr, "   -a N,P,R,D - spawn N AUDIO pairs of tasks, a producer and a consumer:\n");
+	fprintf(stderr, "            the producer fills a buffer every P [us], running for D [%%] of it\n");
+	fprintf(stderr, "            the consumer plays them at the same rate from a ring of R buffers\n");
+	fprintf(stderr, "            and counts underruns, i.e. buffers not ready in time\n");
+	fprintf(stderr, "   -t N,R,C,B - spawn N THREAD churn tasks, each one creating threads:\n");
+	fprintf(stderr, "            R per second (0: as fast as possible), up to C alive at once\n");
+	fprintf(stderr, "            each thread runs for up to B [us] (normally distributed), and exits\n");
+	fprintf(stderr, "   -e N,R[,X] - spawn N EXEC storm tasks, each one forking a child and waiting for it:\n");
+	fprintf(stderr, "            R per second (0: as fast as possible)\n");
+	fprintf(stderr, "            the child exits (X: fork, default), or execs a wlg helper (X: self)\n");
+	fprintf(stderr, "            or the X binary (e.g. /bin/true)\n");
+	fprintf(stderr, " \n");
+}
+
+/* Parse a duration in [s], optionally with a m(inutes), h(ours) or d(ays)
+ * suffix, return 0 on success */
+static int
+parse_duration(const char *str, uint32_t *seconds)
+{
+	unsigned long value;
+	char *end;
+
+	errno = 0;
+	value = strtoul(str, &end, 10);
+	if (errno || end == str)
+		return -1;
+
+	switch (*end) {
+	case 'd':
+		value *= 24;
+		/* fall through */
+	case 'h':
+		value *= 60;
+		/* fall through */
+	case 'm':
+		value *= 60;
+		/* fall through */
+	case 's':
+		++end;
+		/* fall through */
+	case '\0':
+		break;
+	default:
+		return -1;
+	}
+	if (*end || value > UINT32_MAX)
+		return -1;
+
+	*seconds = value;
+	return 0;
+}
+
+static void
+parse_cmdline(int argc, char *argv[])
+{
+	int option_index = 0;
+	uint32_t i;
+	int c;
+
+	while (1) {
+
+		c = getopt_long (argc, argv, opts,
+			long_options, &option_index);
+
+		if (c == -1)
+			break;
 
 		switch(c) {
+		case 0:
+			/* Flag options */
+			break;
 		case 'b':
 			/* DB(printf(FD("B [%s]\n"), optarg)); */
 			if (sscanf(optarg, "%hhu", &conf_bw) < 1) {
@@ -541,10 +4649,167 @@ parse_cmdline(int argc, char *argv[])
 				goto exit_error;
 			}
 			break;
-		case 'd':
-			/* DB(printf(FD("D [%s]\n"), optarg)); */
-			if (sscanf(optarg, "%hhu", &conf_td) < 1) {
-				fprintf(stderr, FE("Wrong workload duration specification\n"));
+		case 'd':
+			/* DB(printf(FD("D [%s]\n"), optarg)); */
+			if (parse_duration(optarg, &conf_td)) {
+				fprintf(stderr, FE("Wrong workload duration specification\n"));
+				goto exit_error;
+			}
+			break;
+		case OPT_ATTR_THRESHOLD:
+			if (sscanf(optarg, "%u", &conf_attr_us) < 1) {
+				fprintf(stderr, FE("Wrong latency attribution threshold\n"));
+				goto exit_error;
+			}
+			break;
+		case OPT_ATTR_RECORDS:
+			if (sscanf(optarg, "%u", &conf_attr_records) < 1 ||
+					!conf_attr_records) {
+				fprintf(stderr, FE("Wrong latency attribution records count\n"));
+				goto exit_error;
+			}
+			break;
+		case OPT_LOG:
+			if (mkdir(optarg, 0755) && errno != EEXIST) {
+				fprintf(stderr, FE("Cannot create events log folder [%s]\n"),
+					optarg);
+				goto exit_error;
+			}
+			conf_log_dir = optarg;
+			break;
+		case OPT_TRIALS:
+			if (sscanf(optarg, "%u", &conf_trials) < 1) {
+				fprintf(stderr, FE("Wrong trials count\n"));
+				goto exit_error;
+			}
+			break;
+		case OPT_TRIALS_WARMUP:
+			if (sscanf(optarg, "%u", &conf_trials_warmup) < 1) {
+				fprintf(stderr, FE("Wrong warmup trials count\n"));
+				goto exit_error;
+			}
+			break;
+		case OPT_SWEEP:
+			if (sscanf(optarg, "%c:%u", &conf_sweep, &conf_sweep_factor) < 1 ||
+					!strchr(SWEEP_KINDS, conf_sweep) ||
+					conf_sweep == 'g' ||
+					!conf_sweep_factor) {
+				fprintf(stderr, FE("Wrong sweep specification\n"));
+				goto exit_error;
+			}
+			break;
+		case OPT_SWEEP_POINT:
+			if (sscanf(optarg, "%u", &conf_sweep_point) < 1 ||
+					!conf_sweep_point) {
+				fprintf(stderr, FE("Wrong sweep point\n"));
+				goto exit_error;
+			}
+			break;
+		case OPT_PROBE:
+			if (sscanf(optarg, "%u", &conf_probe_us) < 1 ||
+					!conf_probe_us) {
+				fprintf(stderr, FE("Wrong probe period\n"));
+				goto exit_error;
+			}
+			break;
+		case OPT_PHASES:
+			if (sscanf(optarg, "%u", &conf_phases) < 1 ||
+					!conf_phases) {
+				fprintf(stderr, FE("Wrong phases count\n"));
+				goto exit_error;
+			}
+			break;
+		case OPT_PHASE:
+			if (phase_spec_parse(optarg)) {
+				fprintf(stderr, FE("Wrong phase specification\n"));
+				goto exit_error;
+			}
+			break;
+		case OPT_SLEEP:
+			if (sleep_parse(optarg)) {
+				fprintf(stderr, FE("Wrong sleep mechanisms\n"));
+				goto exit_error;
+			}
+			conf_sleep = 1;
+			break;
+		case OPT_SPIN_MARGIN:
+			if (sscanf(optarg, "%u", &conf_spin_margin_us) < 1 ||
+					!conf_spin_margin_us) {
+				fprintf(stderr, FE("Wrong spin margin\n"));
+				goto exit_error;
+			}
+			break;
+		case OPT_RATE:
+			if (sscanf(optarg, "%lf", &conf_rate) < 1 ||
+					conf_rate <= 0) {
+				fprintf(stderr, FE("Wrong requests rate\n"));
+				goto exit_error;
+			}
+			break;
+		case OPT_RATE_SWEEP:
+			if (sscanf(optarg, "%lf,%lf,%u", &rate_sweep_from,
+					&rate_sweep_step, &rate_sweep_slo_us) < 3 ||
+					rate_sweep_from <= 0 || rate_sweep_step <= 0) {
+				fprintf(stderr, FE("Wrong rate sweep specification\n"));
+				goto exit_error;
+			}
+			conf_rate_sweep = optarg;
+			break;
+		case OPT_COMPARE:
+			conf_compare = optarg;
+			break;
+		case OPT_WARMUP:
+			if (sscanf(optarg, "%u", &conf_warmup_ms) < 1) {
+				fprintf(stderr, FE("Wrong warmup time\n"));
+				goto exit_error;
+			}
+			break;
+		case OPT_CALIB_FILE:
+			conf_calib_file = optarg;
+			break;
+		case OPT_PELT:
+			if (sscanf(optarg, "%u", &conf_pelt_ms) < 1 ||
+					!conf_pelt_ms) {
+				fprintf(stderr, FE("Wrong load tracking sampling period\n"));
+				goto exit_error;
+			}
+			break;
+		case OPT_PELT_FILE:
+			conf_pelt_file = optarg;
+			break;
+		case OPT_SEED:
+			if (sscanf(optarg, "%llu", (unsigned long long *)&conf_seed) < 1) {
+				fprintf(stderr, FE("Wrong random seed\n"));
+				goto exit_error;
+			}
+			conf_seed_set = 1;
+			break;
+		case OPT_SCHED_DUMP:
+			conf_sched_dump = optarg;
+			break;
+		case OPT_SCHED_REPLAY:
+			conf_sched_replay = optarg;
+			break;
+		case OPT_POWER_MODEL:
+			conf_power_model = optarg;
+			break;
+		case OPT_SAMPLE:
+			if (sscanf(optarg, "%u", &conf_sample_ms) < 1 ||
+					!conf_sample_ms) {
+				fprintf(stderr, FE("Wrong sampling period\n"));
+				goto exit_error;
+			}
+			break;
+		case OPT_COOLDOWN:
+			if (sscanf(optarg, "%u", &conf_cooldown_ms) < 1) {
+				fprintf(stderr, FE("Wrong cooldown time\n"));
+				goto exit_error;
+			}
+			break;
+		case OPT_METRICS_FD:
+			if (sscanf(optarg, "%d", &conf_metrics_fd) < 1) {
+				fprintf(stderr, FE("Wrong metrics file descriptor\n"));
+				goto exit_error;
 			}
 			break;
 		case 'h':
@@ -575,6 +4840,71 @@ parse_cmdline(int argc, char *argv[])
 			}
 			conf_yparams = optarg;
 			break;
+		case 'f':
+			/* DB(printf(FD("F [%s]\n"), optarg)); */
+			if (sscanf(optarg, "%hhu", &conf_fw) < 1) {
+				fprintf(stderr, FE("Wrong FOOTPRINT workload specification\n"));
+				goto exit_error;
+			}
+			conf_fparams = optarg;
+			break;
+		case 'm':
+			/* DB(printf(FD("M [%s]\n"), optarg)); */
+			if (sscanf(optarg, "%hhu", &conf_mw) < 1) {
+				fprintf(stderr, FE("Wrong MISPREDICT workload specification\n"));
+				goto exit_error;
+			}
+			conf_mparams = optarg;
+			break;
+		case 'c':
+			/* DB(printf(FD("C [%s]\n"), optarg)); */
+			if (sscanf(optarg, "%hhu", &conf_cw) < 1) {
+				fprintf(stderr, FE("Wrong CONTENTION workload specification\n"));
+				goto exit_error;
+			}
+			conf_cparams = optarg;
+			break;
+		case 'x':
+			/* DB(printf(FD("X [%s]\n"), optarg)); */
+			if (sscanf(optarg, "%hhu", &conf_xw) < 1 || conf_xw > 127) {
+				fprintf(stderr, FE("Wrong HANDOFF workload specification\n"));
+				goto exit_error;
+			}
+			conf_xparams = optarg;
+			break;
+		case 'a':
+			/* DB(printf(FD("A [%s]\n"), optarg)); */
+			if (sscanf(optarg, "%hhu", &conf_aw) < 1 || conf_aw > 127) {
+				fprintf(stderr, FE("Wrong AUDIO workload specification\n"));
+				goto exit_error;
+			}
+			conf_aparams = optarg;
+			break;
+		case 'e':
+			/* DB(printf(FD("E [%s]\n"), optarg)); */
+			if (sscanf(optarg, "%hhu", &conf_ew) < 1) {
+				fprintf(stderr, FE("Wrong EXEC workload specification\n"));
+				goto exit_error;
+			}
+			conf_eparams = optarg;
+			break;
+		case 't':
+			/* DB(printf(FD("T [%s]\n"), optarg)); */
+			if (sscanf(optarg, "%hhu", &conf_tw) < 1) {
+				fprintf(stderr, FE("Wrong THREAD workload specification\n"));
+				goto exit_error;
+			}
+			conf_tparams = optarg;
+			break;
+		case 'g':
+			/* DB(printf(FD("G [%s]\n"), optarg)); */
+			if (sscanf(optarg, "%hhu", &conf_gw) < 1 ||
+					conf_gw > DAG_NODES_MAX) {
+				fprintf(stderr, FE("Wrong GRAPH workload specification\n"));
+				goto exit_error;
+			}
+			conf_gparams = optarg;
+			break;
 		default:
 			print_usage(argv[0]);
 			abort();
@@ -582,56 +4912,1336 @@ parse_cmdline(int argc, char *argv[])
 
 	}
 
-	return;
+	if ((uint64_t)conf_warmup_ms + conf_cooldown_ms >= (uint64_t)conf_td * S_TO_MS) {
+		fprintf(stderr, FE("Warmup and cooldown exceed the test duration\n"));
+		goto exit_error;
+	}
+	if (conf_trials && conf_trials <= conf_trials_warmup) {
+		fprintf(stderr, FE("Trials must be more than warmup trials\n"));
+		goto exit_error;
+	}
+	if (conf_power_model && !conf_sample_ms)
+		conf_sample_ms = 10;
+	if (conf_sched_dump && conf_sched_replay) {
+		fprintf(stderr, FE("A schedule cannot be both dumped and replayed\n"));
+		goto exit_error;
+	}
+	if ((conf_sweep || conf_rate_sweep) && conf_trials) {
+		fprintf(stderr, FE("A sweep cannot be combined with --trials\n"));
+		goto exit_error;
+	}
+	if (conf_pool && (!conf_trials || conf_compare || conf_phases > 1)) {
+		fprintf(stderr, FE("A pool requires --trials, without --compare or --phases\n"));
+		goto exit_error;
+	}
+	for (i = 0; i < phase_specs_count; ++i)
+		if (phase_specs[i].phase > conf_phases) {
+			fprintf(stderr, FE("A phase specification requires --phases\n"));
+			goto exit_error;
+		}
+	if (conf_pool)
+		conf_phases = conf_trials;
+	if (conf_sweep && conf_rate_sweep) {
+		fprintf(stderr, FE("Workers and rate sweeps cannot be combined\n"));
+		goto exit_error;
+	}
+	if ((conf_rate || conf_rate_sweep) && !conf_iw) {
+		fprintf(stderr, FE("A requests rate requires INTERACTIVE workers\n"));
+		goto exit_error;
+	}
+	if (conf_compare && !conf_trials) {
+		fprintf(stderr, FE("A comparison requires --trials\n"));
+		goto exit_error;
+	}
+
+	return;
+
+exit_error:
+
+	print_usage(argv[0]);
+	exit(-1);
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Trials
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Each trial is a new wlg process, started with the trial configuration and
+ * a --metrics-fd option, which reports its metrics as "<name> <value>" lines
+ * on a pipe. Configurations A (the main command line) and B (--compare) are
+ * interleaved, so that slow drifts of the system affect both of them.
+ */
+
+struct metric {
+	char name[64];
+	double *values[2];
+	uint32_t count[2];
+};
+
+static struct metric *metrics;
+static uint32_t metrics_count;
+/* Runs (trials, or sweep points) whose metrics have been collected */
+static uint32_t metrics_runs[2];
+
+static void
+metric_add(uint8_t config, const char *name, double value)
+{
+	struct metric *m;
+	uint32_t i;
+
+	for (i = 0; i < metrics_count; ++i)
+		if (!strcmp(metrics[i].name, name))
+			break;
+
+	if (i == metrics_count) {
+		metrics = realloc(metrics, ++metrics_count * sizeof(struct metric));
+		if (!metrics)
+			barf("realloc:");
+		m = metrics + i;
+		memset(m, 0, sizeof(struct metric));
+		snprintf(m->name, sizeof(m->name), "%s", name);
+		m->values[0] = calloc(conf_trials, sizeof(double));
+		m->values[1] = calloc(conf_trials, sizeof(double));
+		if (!m->values[0] || !m->values[1])
+			barf("calloc:");
+	}
+
+	/* Metrics not reported by some of the previous runs are NAN there */
+	m = metrics + i;
+	while (m->count[config] < metrics_runs[config])
+		m->values[config][m->count[config]++] = NAN;
+	m->values[config][m->count[config]++] = value;
+}
+
+/* Close a run, keeping the values of each metric aligned to the runs */
+static void
+metrics_align(uint8_t config)
+{
+	uint32_t i;
+
+	++metrics_runs[config];
+	for (i = 0; i < metrics_count; ++i)
+		while (metrics[i].count[config] < metrics_runs[config])
+			metrics[i].values[config][metrics[i].count[config]++] = NAN;
+}
+
+/* Continued fraction evaluation of the incomplete beta function */
+static double
+beta_cf(double a, double b, double x)
+{
+	double c = 1, d, h, del, aa;
+	int m, m2;
+
+	d = 1 - (a + b) * x / (a + 1);
+	if (fabs(d) < 1e-30)
+		d = 1e-30;
+	d = 1 / d;
+	h = d;
+
+	for (m = 1; m <= 200; ++m) {
+		m2 = 2 * m;
+		aa = m * (b - m) * x / ((a + m2 - 1) * (a + m2));
+		d = 1 + aa * d;
+		if (fabs(d) < 1e-30)
+			d = 1e-30;
+		c = 1 + aa / c;
+		if (fabs(c) < 1e-30)
+			c = 1e-30;
+		d = 1 / d;
+		h *= d * c;
+		aa = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1));
+		d = 1 + aa * d;
+		if (fabs(d) < 1e-30)
+			d = 1e-30;
+		c = 1 + aa / c;
+		if (fabs(c) < 1e-30)
+			c = 1e-30;
+		d = 1 / d;
+		del = d * c;
+		h *= del;
+		if (fabs(del - 1) < 1e-10)
+			break;
+	}
+
+	return h;
+}
+
+/* Regularized incomplete beta function I_x(a, b) */
+static double
+beta_inc(double a, double b, double x)
+{
+	double bt;
+
+	if (x <= 0)
+		return 0;
+	if (x >= 1)
+		return 1;
+
+	bt = exp(lgamma(a + b) - lgamma(a) - lgamma(b)
+		+ a * log(x) + b * log(1 - x));
+	if (x < (a + 1) / (a + b + 2))
+		return bt * beta_cf(a, b, x) / a;
+
+	return 1 - bt * beta_cf(b, a, 1 - x) / b;
+}
+
+/* Two-sided p-value of a Student's t statistic with df degrees of freedom */
+static double
+student_p(double t, double df)
+{
+	return beta_inc(df / 2, 0.5, df / (df + t * t));
+}
+
+/* Two-sided 95% critical value of the Student's t distribution */
+static double
+student_t95(double df)
+{
+	double lo = 0, hi = 1000, mid;
+	int i;
+
+	for (i = 0; i < 100; ++i) {
+		mid = (lo + hi) / 2;
+		if (student_p(mid, df) > 0.05)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	return mid;
+}
+
+static void
+metric_stats(struct metric *m, uint8_t config,
+		double *mean, double *var, uint32_t *n)
+{
+	double *values = m->values[config];
+	uint32_t i;
+
+	/* Values are indexed by trial, the warmup ones are discarded */
+	*mean = *var = 0;
+	*n = 0;
+	for (i = conf_trials_warmup; i < m->count[config]; ++i) {
+		if (isnan(values[i]))
+			continue;
+		*mean += values[i];
+		++*n;
+	}
+	if (!*n)
+		return;
+	*mean /= *n;
+
+	if (*n < 2)
+		return;
+	for (i = conf_trials_warmup; i < m->count[config]; ++i)
+		if (!isnan(values[i]))
+			*var += (values[i] - *mean) * (values[i] - *mean);
+	*var /= *n - 1;
+}
+
+/* Run a trial with the specified options and collect its metrics */
+static void
+run_trial(uint8_t config, char *argv[])
+{
+	char line[128], name[64], fd_str[16];
+	double value;
+	int pipe_fd[2];
+	int status, null_fd;
+	pid_t child;
+	FILE *fp;
+	int argc;
+
+	for (argc = 0; argv[argc]; ++argc);
+
+	if (pipe(pipe_fd))
+		barf("pipe:");
+
+	child = fork();
+	if (child < 0)
+		barf("fork:");
+
+	if (!child) {
+		close(pipe_fd[0]);
+		snprintf(fd_str, sizeof(fd_str), "%d", pipe_fd[1]);
+		argv[argc] = "--metrics-fd";
+		argv[argc + 1] = fd_str;
+		argv[argc + 2] = NULL;
+		if (!conf_vr) {
+			null_fd = open("/dev/null", O_WRONLY);
+			if (null_fd >= 0)
+				dup2(null_fd, STDOUT_FILENO);
+		}
+		execv("/proc/self/exe", argv);
+		barf("execv:");
+	}
+
+	close(pipe_fd[1]);
+	fp = fdopen(pipe_fd[0], "r");
+	if (!fp)
+		barf("fdopen:");
+	while (fgets(line, sizeof(line), fp))
+		if (sscanf(line, "%63s %lf", name, &value) == 2)
+			metric_add(config, name, value);
+	fclose(fp);
+	metrics_align(config);
+
+	if (waitpid(child, &status, 0) < 0)
+		barf("waitpid:");
+	if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+		fprintf(stderr, FE("Trial failed (status: %d)\n"), status);
+		exit(-1);
+	}
+}
+
+static void
+report_trials(void)
+{
+	double mean[2], var[2], ci[2], se, t, df, p;
+	uint32_t n[2], i;
+	struct metric *m;
+
+	printf(FI("Metrics over %u trials (%u warmup trials discarded), 95%% confidence intervals:\n"),
+		conf_trials - conf_trials_warmup, conf_trials_warmup);
+
+	for (i = 0; i < metrics_count; ++i) {
+		m = metrics + i;
+
+		metric_stats(m, 0, &mean[0], &var[0], &n[0]);
+		ci[0] = (n[0] > 1) ? student_t95(n[0] - 1) * sqrt(var[0] / n[0]) : 0;
+		if (!conf_compare) {
+			printf(FI("%-24s %14.3f +- %12.3f (%6.2f%%)\n"),
+				m->name, mean[0], ci[0],
+				mean[0] ? 100 * ci[0] / fabs(mean[0]) : 0);
+			continue;
+		}
+
+		metric_stats(m, 1, &mean[1], &var[1], &n[1]);
+		ci[1] = (n[1] > 1) ? student_t95(n[1] - 1) * sqrt(var[1] / n[1]) : 0;
+
+		/* Welch's t-test */
+		p = 1;
+		if (n[0] > 1 && n[1] > 1) {
+			se = var[0] / n[0] + var[1] / n[1];
+			if (se > 0) {
+				t = (mean[1] - mean[0]) / sqrt(se);
+				df = se * se / (var[0] * var[0] / ((double)n[0] * n[0] * (n[0] - 1))
+					+ var[1] * var[1] / ((double)n[1] * n[1] * (n[1] - 1)));
+				p = student_p(t, df);
+			} else if (mean[0] != mean[1]) {
+				p = 0;
+			}
+		}
+
+		printf(FI("%-24s A %14.3f +- %12.3f  B %14.3f +- %12.3f  delta %+8.2f%%  p %.4f%s\n"),
+			m->name, mean[0], ci[0], mean[1], ci[1],
+			mean[0] ? 100 * (mean[1] - mean[0]) / fabs(mean[0]) : 0,
+			p, (p < 0.05) ? " (significant)" : "");
+	}
+}
+
+static void
+run_trials(char *argv[])
+{
+	char **argv_a, **argv_b = NULL;
+	char *compare, *token;
+	uint32_t argc, k;
+
+	/* Room for the metrics-fd option */
+	for (argc = 0; argv[argc]; ++argc);
+	argv_a = calloc(argc + 3, sizeof(char *));
+	if (!argv_a)
+		barf("calloc:");
+	memcpy(argv_a, argv, argc * sizeof(char *));
+
+	if (conf_compare) {
+		compare = strdup(conf_compare);
+		argv_b = calloc(strlen(compare) / 2 + 5, sizeof(char *));
+		if (!compare || !argv_b)
+			barf("calloc:");
+		argc = 0;
+		argv_b[argc++] = argv[0];
+		while ((token = strsep(&compare, " \t")))
+			if (*token)
+				argv_b[argc++] = token;
+	}
+
+	for (k = 0; k < conf_trials; ++k) {
+		printf(FI("Trial %u/%u: A\n"), k + 1, conf_trials);
+		run_trial(0, argv_a);
+		if (!argv_b)
+			continue;
+		printf(FI("Trial %u/%u: B\n"), k + 1, conf_trials);
+		run_trial(1, argv_b);
+	}
+
+	report_trials();
+}
+
+/*
+ * A sweep runs a trial per count of the swept kind of workers, in the same
+ * way, and reports the scaling curve. The trial is told its count with a
+ * --sweep-point option, which overrides the one of the command line.
+ */
+
+static void
+sweep_point_setup(void)
+{
+	static uint8_t *counts[] = { &conf_bw, &conf_iw, &conf_pw, &conf_yw,
+		&conf_fw, &conf_mw, &conf_cw, &conf_xw, &conf_gw, &conf_aw,
+		&conf_tw, &conf_ew };
+	static char **params[] = { NULL, &conf_iparams, &conf_pparams,
+		&conf_yparams, &conf_fparams, &conf_mparams, &conf_cparams,
+		&conf_xparams, &conf_gparams, &conf_aparams, &conf_tparams,
+		&conf_eparams };
+	/* Per-worker parameters, replicated from the first worker ones */
+	static const uint8_t per_worker[] = { 0, 2, 2, 2, 1, 1, 0, 0, 0, 0, 0, 0 };
+	uint8_t kind = strchr(SWEEP_KINDS, conf_sweep) - SWEEP_KINDS;
+	char *spec, *first;
+	size_t len;
+	uint32_t i;
+
+	*counts[kind] = conf_sweep_point;
+	if (!per_worker[kind] || !*params[kind])
+		return;
+
+	/* Skip the count, and keep the parameters of the first worker */
+	first = strchr(*params[kind], ',');
+	if (!first)
+		return;
+	for (i = 0, len = 0; first[len] && i <= per_worker[kind]; ++len)
+		if (first[len] == ',')
+			++i;
+	if (i > per_worker[kind])
+		--len;
+
+	spec = malloc(4 + (len + 1) * conf_sweep_point);
+	if (!spec)
+		barf("malloc:");
+	snprintf(spec, 4, "%u", conf_sweep_point);
+	for (i = 0; i < conf_sweep_point; ++i)
+		strncat(spec, first, len);
+	*params[kind] = spec;
+}
+
+/* Value of a metric at a sweep point (NAN if not reported) */
+static double
+sweep_metric(const char *name, uint32_t point)
+{
+	uint32_t i;
+
+	for (i = 0; i < metrics_count; ++i)
+		if (!strcmp(metrics[i].name, name))
+			return metrics[i].values[0][point];
+
+	return NAN;
+}
+
+/* Value of a metric at a sweep point, as a string ("-" if not reported) */
+static const char *
+sweep_value(char *buf, size_t size, const char *name, uint32_t point)
+{
+	double value = sweep_metric(name, point);
+
+	if (isnan(value))
+		snprintf(buf, size, "-");
+	else
+		snprintf(buf, size, "%.3f", value);
+	return buf;
+}
+
+static void
+run_sweep(char *argv[])
+{
+	uint8_t kind = strchr(SWEEP_KINDS, conf_sweep) - SWEEP_KINDS;
+	char name[64], value[6][32], point_str[16];
+	uint32_t count_max, step, count, j;
+	uint32_t *counts;
+	double base = 0;
+	char **argv_s;
+	int argc;
+	long cpus;
+
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cpus < 1)
+		cpus = 1;
+
+	/* Counts of HANDOFF and AUDIO workers are pairs */
+	count_max = conf_sweep_factor * cpus;
+	step = (cpus + 3) / 4;
+	if (kind == WORKER_HANDOFF || kind == WORKER_AUDIO) {
+		count_max /= 2;
+		step = (step + 1) / 2;
+	}
+	if (count_max > UINT8_MAX)
+		count_max = UINT8_MAX;
+	if (!count_max)
+		count_max = 1;
+
+	/* The sweep points are 1 and then multiples of a quarter of the CPUs */
+	counts = calloc(count_max + 1, sizeof(uint32_t));
+	if (!counts)
+		barf("calloc:");
+	conf_trials = 0;
+	counts[conf_trials++] = 1;
+	for (count = step; count <= count_max; count += step)
+		if (count > 1)
+			counts[conf_trials++] = count;
+	conf_trials_warmup = 0;
+
+	/* Room for the sweep-point and metrics-fd options */
+	for (argc = 0; argv[argc]; ++argc);
+	argv_s = calloc(argc + 5, sizeof(char *));
+	if (!argv_s)
+		barf("calloc:");
+	memcpy(argv_s, argv, argc * sizeof(char *));
+	argv_s[argc] = "--sweep-point";
+	argv_s[argc + 1] = point_str;
+
+	for (j = 0; j < conf_trials; ++j) {
+		printf(FI("Sweep point %u/%u: %u %s workers%s\n"), j + 1,
+			conf_trials, counts[j], worker_kind[kind],
+			(kind == WORKER_HANDOFF || kind == WORKER_AUDIO) ?
+				" pairs" : "");
+		snprintf(point_str, sizeof(point_str), "%u", counts[j]);
+		run_trial(0, argv_s);
+		argv_s[argc + 2] = NULL;
+	}
+
+	printf(FI("%s workers sweep, %u online CPUs, %u [s] per point:\n"),
+		worker_kind[kind], (unsigned)cpus, conf_td);
+	printf(FI("%6s %16s %8s %8s %14s %14s %14s\n"), "count",
+		worker_unit[kind], "speedup", "fairness", "lat_p99 [us]",
+		"probe_p50 [us]", "probe_p99 [us]");
+	for (j = 0; j < conf_trials; ++j) {
+		snprintf(name, sizeof(name), "%s.%s/s", worker_kind[kind],
+			worker_unit[kind]);
+		sweep_value(value[0], sizeof(value[0]), name, j);
+		if (!j)
+			base = atof(value[0]);
+		snprintf(value[1], sizeof(value[1]), "-");
+		if (base && strcmp(value[0], "-"))
+			snprintf(value[1], sizeof(value[1]), "%.2f",
+				atof(value[0]) / base);
+		snprintf(name, sizeof(name), "%s.fairness", worker_kind[kind]);
+		sweep_value(value[2], sizeof(value[2]), name, j);
+		snprintf(name, sizeof(name), "%s.lat_p99_us", worker_kind[kind]);
+		sweep_value(value[3], sizeof(value[3]), name, j);
+		sweep_value(value[4], sizeof(value[4]), "Probe.lat_p50_us", j);
+		sweep_value(value[5], sizeof(value[5]), "Probe.lat_p99_us", j);
+		printf(FI("%6u %16s %8s %8s %14s %14s %14s\n"), counts[j],
+			value[0], value[1], value[2], value[3], value[4],
+			value[5]);
+	}
+
+	free(argv_s);
+	free(counts);
+}
+
+/*
+ * A rate sweep runs a trial per offered requests rate, increasing it until
+ * the workers saturate, i.e. the response times p99 exceeds the SLO or the
+ * requests pile up in their queues.
+ */
+#define RATE_SWEEP_POINTS_MAX 64
+/* Requests left in the queues at the end, when saturated [%] */
+#define RATE_SWEEP_BACKLOG_PCT 5
+
+static void
+run_rate_sweep(char *argv[])
+{
+	double rate, achieved, p99, backlog, best = 0;
+	char rate_str[32], value[2][32];
+	char **argv_s;
+	uint32_t j;
+	int argc;
+
+	/* Room for the rate and metrics-fd options */
+	for (argc = 0; argv[argc]; ++argc);
+	argv_s = calloc(argc + 5, sizeof(char *));
+	if (!argv_s)
+		barf("calloc:");
+	memcpy(argv_s, argv, argc * sizeof(char *));
+	argv_s[argc] = "--rate";
+	argv_s[argc + 1] = rate_str;
+
+	conf_trials = RATE_SWEEP_POINTS_MAX;
+	conf_trials_warmup = 0;
+
+	printf(FI("%14s %14s %14s %14s %12s\n"), "offered [1/s]",
+		"achieved [1/s]", "resp_p50 [us]", "resp_p99 [us]",
+		"backlog [%]");
+	for (j = 0; j < RATE_SWEEP_POINTS_MAX; ++j) {
+		rate = rate_sweep_from + j * rate_sweep_step;
+		snprintf(rate_str, sizeof(rate_str), "%f", rate);
+		run_trial(0, argv_s);
+		argv_s[argc + 2] = NULL;
+
+		achieved = sweep_metric("Interactive.activations/s", j);
+		p99 = sweep_metric("Interactive.resp_p99_us", j);
+		backlog = sweep_metric("Interactive.backlog_pct", j);
+		printf(FI("%14.1f %14.1f %14s %14s %12.2f\n"), rate, achieved,
+			sweep_value(value[0], sizeof(value[0]),
+				"Interactive.resp_p50_us", j),
+			sweep_value(value[1], sizeof(value[1]),
+				"Interactive.resp_p99_us", j), backlog);
+
+		/* Saturated, i.e. queues grow without bounds */
+		if (isnan(p99) || p99 > rate_sweep_slo_us ||
+				backlog > RATE_SWEEP_BACKLOG_PCT)
+			break;
+		best = rate;
+	}
+
+	if (best)
+		printf(FI("Maximum sustainable rate: %.1f [requests/s] (p99 SLO %u [us])\n"),
+			best, rate_sweep_slo_us);
+	else
+		printf(FI("No sustainable rate from %.1f [requests/s] (p99 SLO %u [us])\n"),
+			rate_sweep_from, rate_sweep_slo_us);
+	if (j == RATE_SWEEP_POINTS_MAX)
+		printf(FI("Not saturated within %u rates, the maximum one may be higher\n"),
+			RATE_SWEEP_POINTS_MAX);
+
+	free(argv_s);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Main
+////////////////////////////////////////////////////////////////////////////////
+
+static pthread_t
+create_worker(struct wdata *wdata)
+{
+	pthread_attr_t attr;
+	pthread_t childid;
+	uint32_t i;
+	int err;
+
+	/* Setup worker name */
+	snprintf(wdata->name, sizeof(wdata->name), "wlg_%c%03d",
+		worker_kind[wdata->kind][0], wdata->id);
+
+	/* Setup random number generator and activations schedule */
+	wdata->rnd = worker_seed(wdata);
+	for (i = 0; i < schedules_count; ++i)
+		if (!strcmp(schedules[i].name, wdata->name))
+			wdata->sched = schedules + i;
+	schedule_dump(wdata);
+
+	/* thread mode */
+	if (pthread_attr_init(&attr) != 0)
+		barf("pthread_attr_init:");
+
+	err = pthread_create(&childid, &attr, worker, (void*)wdata);
+	if (err != 0) {
+		fprintf(stderr, "pthread_create failed: %s (%d)\n",
+				strerror(err), err);
+		exit(-1);
+	}
+	return childid;
+
+
+}
+
+/* Set the parameters of the workers for the phase, if specified */
+static void
+phase_params(uint32_t phase)
+{
+	struct phase_spec *ps;
+	struct wdata *wdata;
+	uint32_t *pair;
+	uint32_t s, i, k;
+
+	for (s = 0; s < phase_specs_count; ++s) {
+		ps = phase_specs + s;
+		if (ps->phase != phase + 1)
+			continue;
+		for (i = 0, k = 0; i < workers_count; ++i) {
+			wdata = workers_data + i;
+			if (wdata->kind != ps->kind || worker_probe(wdata))
+				continue;
+			pair = ps->values + 2 * ((k < ps->pairs) ? k : ps->pairs - 1);
+			++k;
+			dist_free(wdata->dist[0]);
+			dist_free(wdata->dist[1]);
+			wdata->dist[0] = wdata->dist[1] = NULL;
+
+			switch (wdata->kind) {
+			case WORKER_INTERACTIVE:
+				wdata->params.interrupt.interval_max = pair[0];
+				wdata->params.interrupt.duration_max = pair[1];
+				printf(FI("%s: max_interval %6d [us], max_duration %6d [us]\n"),
+					wdata->name, pair[0], pair[1]);
+				break;
+			case WORKER_PERIODC:
+				wdata->params.period.duration = pair[0];
+				wdata->params.period.duty_cycle = pair[1];
+				printf(FI("%s:     interval %6d [us], duty-cycle   %6d [%%]\n"),
+					wdata->name, pair[0], pair[1]);
+				break;
+			case WORKER_YIELD:
+				wdata->params.yield.period = pair[0];
+				wdata->params.yield.interval = pair[1];
+				printf(FI("%s:     period %6d [us], yield_interval %6d [us]\n"),
+					wdata->name, pair[0], pair[1]);
+				break;
+			}
+		}
+	}
+}
+
+/*
+ * Re-arm the workers, while parked between two phases, so that the next
+ * phase starts from a clean state but for the threads, and their placement
+ */
+static void
+phase_arm(uint32_t phase)
+{
+	struct dag_node *node;
+	struct wdata *wdata;
+	uint32_t i, f;
+
+	phase_params(phase);
+	requests_arrival_ns = 0;
+	for (i = 0; i < workers_count; ++i) {
+		wdata = workers_data + i;
+		wdata->loops = 0;
+		wdata->run_ns = 0;
+		wdata->win_start_ns = 0;
+		wdata->win_loops = 0;
+		wdata->win_cpu_ns = 0;
+		sketch_reset(wdata->lat);
+		if (wdata->oversleep)
+			sketch_reset(wdata->oversleep);
+		wdata->spin_ns = 0;
+		wdata->work_ns = 0;
+		if (wdata->resp)
+			sketch_reset(wdata->resp);
+		wdata->arrival_ns = 0;
+		wdata->backlog = 0;
+		wdata->occ_next = 0;
+		wdata->occ_wrapped = 0;
+		wdata->occ_cur.cpu = -1;
+		wdata->spikes_count = 0;
+		if (wdata->bursts)
+			memset(wdata->bursts, 0,
+				cpus_count * sizeof(struct burst_stats));
+		memset(wdata->handoff_count, 0, sizeof(wdata->handoff_count));
+		memset(wdata->handoff_ns, 0, sizeof(wdata->handoff_ns));
+	}
+
+	for (i = 0; i < conf_aw; ++i) {
+		audio_paths[i].produced = 0;
+		audio_paths[i].consumed = 0;
+		audio_paths[i].producer_tick = 0;
+		audio_paths[i].consumer_tick = 0;
+		audio_paths[i].buffers = 0;
+		audio_paths[i].underruns = 0;
+		audio_paths[i].overruns = 0;
+		sketch_reset(audio_paths[i].late);
+	}
+
+	for (i = 0; i < conf_tw; ++i) {
+		churns[i].failed = 0;
+		churns[i].missed = 0;
+		sketch_reset(churns[i].spawn);
+		sketch_reset(churns[i].first_run);
+		sketch_reset(churns[i].lifetime);
+	}
+
+	for (i = 0; i < conf_ew; ++i) {
+		storms[i].failed = 0;
+		storms[i].next_ns = 0;
+		sketch_reset(storms[i].fork);
+		sketch_reset(storms[i].first_run);
+		sketch_reset(storms[i].exec);
+		sketch_reset(storms[i].total);
+	}
+
+	if (dag) {
+		dag->stop = 0;
+		dag->start_ns = 0;
+		dag->next_vsync = 0;
+		dag->frames_done = 0;
+		memset(dag->frame_start_ns, 0, sizeof(dag->frame_start_ns));
+		memset(dag->sinks_remaining, 0, sizeof(dag->sinks_remaining));
+		dag->frames = 0;
+		dag->janks = 0;
+		dag->dropped = 0;
+		sketch_reset(dag->lat);
+		for (i = 0; i < dag->nodes_count; ++i) {
+			node = dag->nodes + i;
+			sem_destroy(&node->ready);
+			sem_init(&node->ready, 0, 0);
+			for (f = 0; f < DAG_FRAMES; ++f) {
+				node->remaining[f] = node->preds_count;
+				node->ready_ns[f] = 0;
+			}
+			node->frame = 0;
+		}
+	}
+
+	sampling_phase_begin();
+}
+
+static void
+report_workers(void)
+{
+	double totals[ARRAY_SIZE(worker_kind)] = { 0 };
+	double squares[ARRAY_SIZE(worker_kind)] = { 0 };
+	uint16_t counts[ARRAY_SIZE(worker_kind)] = { 0 };
+	struct wdata *wdata;
+	double rate;
+	uint32_t i;
+
+	printf(FI("Workers throughput:\n"));
+	for (i = 0; i < workers_count; ++i) {
+		wdata = workers_data + i;
+		if (!wdata->run_ns)
+			continue;
+		rate = (double)wdata->loops * S_TO_NS / wdata->run_ns;
+		printf(FI("%-8.8s: %12llu %-11s %14.1f [%s/s]\n"),
+			wdata->name, (unsigned long long)wdata->loops,
+			worker_unit[wdata->kind], rate,
+			worker_unit[wdata->kind]);
+		if (worker_probe(wdata))
+			continue;
+		totals[wdata->kind] += rate;
+		squares[wdata->kind] += rate * rate;
+		++counts[wdata->kind];
+	}
+
+	/* Data transfers cost, by workers placement */
+	for (i = 0; i < workers_count; ++i) {
+		uint8_t p;
+
+		wdata = workers_data + i;
+		if (wdata->kind != WORKER_HANDOFF || wdata->params.handoff.producer)
+			continue;
+		for (p = 0; p < ARRAY_SIZE(placement_name); ++p) {
+			if (!wdata->handoff_count[p])
+				continue;
+			rate = (double)wdata->handoff_ns[p] / wdata->handoff_count[p];
+			printf(FI("%-8.8s: %-13s %10llu transfers, latency %10.3f [us], bandwidth %10.1f [MB/s]\n"),
+				wdata->name, placement_name[p],
+				(unsigned long long)wdata->handoff_count[p],
+				rate / US_TO_NS,
+				(wdata->params.handoff.pair->words * sizeof(uint64_t))
+					* (S_TO_NS / rate) / (1024 * 1024));
+		}
+	}
 
-exit_error:
+	/* Aggregated throughput of groups of workers, and its Jain's fairness */
+	for (i = 0; i < ARRAY_SIZE(worker_kind); ++i) {
+		if (counts[i] < 2)
+			continue;
+		printf(FI("wlg_%c***: %12u workers     %14.1f [%s/s], fairness %.3f\n"),
+			worker_kind[i][0], counts[i], totals[i], worker_unit[i],
+			squares[i] ? totals[i] * totals[i] / (counts[i] * squares[i]) : 0);
+	}
+}
 
-	print_usage(argv[0]);
-	exit(-1);
+/* Audio paths: glitches and producers lateness */
+static void
+report_audio(void)
+{
+	struct audio *path;
+	char name[9];
+	uint32_t i;
+
+	if (!conf_aw)
+		return;
+
+	printf(FI("Audio paths:\n"));
+	for (i = 0; i < conf_aw; ++i) {
+		path = audio_paths + i;
+		snprintf(name, sizeof(name), "wlg_A%03d", 2 * i + 1);
+		printf(FI("%-8.8s: %12llu buffers, %llu underruns (%.2f per minute), %llu overruns\n"),
+			name, (unsigned long long)path->buffers,
+			(unsigned long long)path->underruns,
+			path->underruns ? 60.0 * path->underruns * S_TO_US
+				/ path->period_us / (path->buffers + path->underruns) : 0,
+			(unsigned long long)path->overruns);
+		sketch_print(name, "lateness", path->late);
+	}
+}
 
+/* Thread churn: threads creation, startup and lifetime */
+static void
+report_thread(void)
+{
+	struct churn *churn;
+	char name[9];
+	uint32_t i;
+
+	if (!conf_tw)
+		return;
+
+	printf(FI("Threads churn:\n"));
+	for (i = 0; i < conf_tw; ++i) {
+		churn = churns + i;
+		snprintf(name, sizeof(name), "wlg_T%03d", i + 1);
+		printf(FI("%-8.8s: %12llu threads, %llu failed, %llu missed (%u alive at most)\n"),
+			name, (unsigned long long)churn->spawn->count,
+			(unsigned long long)churn->failed,
+			(unsigned long long)churn->missed, churn->concurrency);
+		sketch_print(name, "spawn", churn->spawn);
+		sketch_print(name, "first run", churn->first_run);
+		sketch_print(name, "lifetime", churn->lifetime);
+	}
 }
 
+/* Processes storm: processes creation, startup and exec */
+static void
+report_exec(void)
+{
+	struct storm *storm;
+	char name[9];
+	uint32_t i;
+
+	if (!conf_ew)
+		return;
+
+	printf(FI("Processes storm:\n"));
+	for (i = 0; i < conf_ew; ++i) {
+		storm = storms + i;
+		snprintf(name, sizeof(name), "wlg_E%03d", i + 1);
+		printf(FI("%-8.8s: %12llu processes, %llu failed\n"),
+			name, (unsigned long long)storm->total->count,
+			(unsigned long long)storm->failed);
+		sketch_print(name, "fork", storm->fork);
+		sketch_print(name, "first run", storm->first_run);
+		if (storm->mode == STORM_SELF)
+			sketch_print(name, "exec", storm->exec);
+		sketch_print(name, "completion", storm->total);
+	}
+}
 
+/* Frames pipeline: end to end latency and missed deadlines */
+static void
+report_graph(void)
+{
+	if (!dag)
+		return;
+
+	printf(FI("Frames pipeline:\n"));
+	printf(FI("wlg_G***: %12llu frames, %llu janky (%.2f%%), %llu dropped\n"),
+		(unsigned long long)dag->frames,
+		(unsigned long long)dag->janks,
+		dag->frames ? 100.0 * dag->janks / dag->frames : 0,
+		(unsigned long long)dag->dropped);
+	if (dag->lat->count)
+		sketch_print("wlg_G***", "frame latency", dag->lat);
+}
 
-////////////////////////////////////////////////////////////////////////////////
-// Main
-////////////////////////////////////////////////////////////////////////////////
+/* Time slept past the deadlines, per sleep mechanism */
+static void
+report_sleep(void)
+{
+	struct sketch *oversleep;
+	struct wdata *wdata;
+	char what[32];
+	uint32_t i, m;
+
+	if (!conf_sleep && !conf_spin_margin_us)
+		return;
+
+	printf(FI("Oversleep per sleep mechanism:\n"));
+	oversleep = sketch_new();
+	for (m = 0; m < sleeps_count; ++m) {
+		sketch_reset(oversleep);
+		for (i = 0; i < workers_count; ++i)
+			if (workers_data[i].oversleep &&
+					workers_data[i].sleep == m)
+				sketch_merge(oversleep, workers_data[i].oversleep);
+		if (sleeps[m].slack_ns)
+			snprintf(what, sizeof(what), "%s:%u oversleep",
+				sleep_name[sleeps[m].mech], sleeps[m].slack_ns);
+		else
+			snprintf(what, sizeof(what), "%s oversleep",
+				sleep_name[sleeps[m].mech]);
+		sketch_print("wlg_****", what, oversleep);
+	}
+	free(oversleep);
+
+	for (i = 0, m = 0; i < workers_count; ++i) {
+		wdata = workers_data + i;
+		if (!wdata->spin_margin_ns || !wdata->spin_ns)
+			continue;
+		if (!m++)
+			printf(FI("Spinning before the deadlines:\n"));
+		printf(FI("%-8.8s: work %10.3f [ms], spin %10.3f [ms] (%5.1f [%%] of the CPU time)\n"),
+			wdata->name, (double)wdata->work_ns / MS_TO_NS,
+			(double)wdata->spin_ns / MS_TO_NS,
+			100.0 * wdata->spin_ns / (wdata->spin_ns + wdata->work_ns));
+	}
+}
 
-static pthread_t
-create_worker(struct wdata *wdata)
+/* Wakeup latencies: per worker, per kind of workers and overall */
+static void
+report_latency(void)
 {
-	pthread_attr_t attr;
-	pthread_t childid;
-	int err;
+	struct sketch *kinds[ARRAY_SIZE(worker_kind)] = { NULL };
+	struct sketch *all;
+	struct wdata *wdata;
+	uint64_t backlog;
+	char name[9];
+	uint32_t i;
+
+	all = sketch_new();
+	printf(FI("Wakeup latencies:\n"));
+	for (i = 0; i < workers_count; ++i) {
+		wdata = workers_data + i;
+		if (!wdata->lat || !wdata->lat->count)
+			continue;
+		sketch_print(wdata->name, "latency", wdata->lat);
+		if (worker_probe(wdata))
+			continue;
+		if (!kinds[wdata->kind])
+			kinds[wdata->kind] = sketch_new();
+		sketch_merge(kinds[wdata->kind], wdata->lat);
+		sketch_merge(all, wdata->lat);
+	}
 
-	/* thread mode */
-	if (pthread_attr_init(&attr) != 0)
-		barf("pthread_attr_init:");
+	for (i = 0; i < ARRAY_SIZE(worker_kind); ++i) {
+		if (!kinds[i])
+			continue;
+		snprintf(name, sizeof(name), "wlg_%c***", worker_kind[i][0]);
+		sketch_print(name, "latency", kinds[i]);
+		free(kinds[i]);
+	}
+	sketch_print("wlg_****", "latency", all);
+	free(all);
+
+	report_sleep();
+
+	if (!conf_rate)
+		return;
+
+	/* Open-loop requests response times, the backlog is a shared one */
+	all = sketch_new();
+	backlog = 0;
+	printf(FI("Response times, %.1f [requests/s] offered:\n"), conf_rate);
+	for (i = 0; i < workers_count; ++i) {
+		wdata = workers_data + i;
+		backlog += wdata->backlog;
+		if (!wdata->resp || !wdata->resp->count)
+			continue;
+		sketch_print(wdata->name, "response", wdata->resp);
+		sketch_merge(all, wdata->resp);
+	}
+	sketch_print("wlg_I***", "response", all);
+	if (backlog)
+		printf(FI("wlg_I***: %12llu requests not served (backlog)\n"),
+			(unsigned long long)backlog);
+	free(all);
+}
 
-	err = pthread_create(&childid, &attr, worker, (void*)wdata);
-	if (err != 0) {
-		fprintf(stderr, "pthread_create failed: %s (%d)\n",
-				strerror(err), err);
-		exit(-1);
+/* Core type of a CPU: its kernel reported, or else calibrated, capacity */
+static long
+cpu_core_type(int cpu)
+{
+	if (cpus_topology[cpu].sysfs_capacity > 0)
+		return cpus_topology[cpu].sysfs_capacity;
+	return cpus_topology[cpu].capacity;
+}
+
+/* Capacity invariant bursts: time taken on each type of core */
+static void
+report_bursts(void)
+{
+	struct burst_stats *cpus, type;
+	uint8_t *reported;
+	char cpus_list[64];
+	int cpu, other, len;
+	uint32_t i;
+
+	if (!conf_invariant)
+		return;
+
+	cpus = calloc(cpus_count, sizeof(struct burst_stats));
+	reported = calloc(cpus_count, sizeof(uint8_t));
+	if (!cpus || !reported)
+		barf("calloc:");
+
+	for (i = 0; i < workers_count; ++i) {
+		if (!workers_data[i].bursts)
+			continue;
+		for (cpu = 0; cpu < cpus_count; ++cpu) {
+			cpus[cpu].count  += workers_data[i].bursts[cpu].count;
+			cpus[cpu].ref_ns += workers_data[i].bursts[cpu].ref_ns;
+			cpus[cpu].run_ns += workers_data[i].bursts[cpu].run_ns;
+		}
 	}
-	return childid;
 
+	printf(FI("Bursts time by core type:\n"));
+	for (cpu = 0; cpu < cpus_count; ++cpu) {
+		if (reported[cpu])
+			continue;
+
+		memset(&type, 0, sizeof(type));
+		cpus_list[0] = '\0';
+		for (other = cpu, len = 0; other < cpus_count; ++other) {
+			if (reported[other] ||
+					cpu_core_type(other) != cpu_core_type(cpu))
+				continue;
+			reported[other] = 1;
+			type.count  += cpus[other].count;
+			type.ref_ns += cpus[other].ref_ns;
+			type.run_ns += cpus[other].run_ns;
+			if (len < (int)sizeof(cpus_list))
+				len += snprintf(cpus_list + len, sizeof(cpus_list) - len,
+						"%s%d", len ? "," : "", other);
+		}
+		if (!type.count)
+			continue;
+
+		printf(FI("capacity %4ld, CPUs %-16s: %8llu bursts, "
+			"reference %10.1f [us], taken %10.1f [us], ratio %.3f\n"),
+			cpu_core_type(cpu), cpus_list, (unsigned long long)type.count,
+			(double)type.ref_ns / type.count / US_TO_NS,
+			(double)type.run_ns / type.count / US_TO_NS,
+			(double)type.run_ns / type.ref_ns);
+	}
 
+	free(reported);
+	free(cpus);
 }
 
-static uint32_t workers_count = 0;
-static struct wdata *workers_data;
-static pthread_t *workers;
+/* Machine readable metrics of a run, see run_trial() */
+static void
+metrics_write(FILE *fp)
+{
+	double totals[ARRAY_SIZE(worker_kind)] = { 0 };
+	double squares[ARRAY_SIZE(worker_kind)] = { 0 };
+	uint16_t counts[ARRAY_SIZE(worker_kind)] = { 0 };
+	struct sketch *kinds[ARRAY_SIZE(worker_kind)] = { NULL };
+	struct wdata *wdata;
+	double rate;
+	uint32_t i;
+
+	for (i = 0; i < workers_count; ++i) {
+		wdata = workers_data + i;
+		if (!wdata->run_ns)
+			continue;
+		if (worker_probe(wdata)) {
+			if (!wdata->lat->count)
+				continue;
+			fprintf(fp, "Probe.lat_p50_us %f\n",
+				(double)sketch_quantile(wdata->lat, 0.50) / US_TO_NS);
+			fprintf(fp, "Probe.lat_p99_us %f\n",
+				(double)sketch_quantile(wdata->lat, 0.99) / US_TO_NS);
+			continue;
+		}
+		rate = (double)wdata->loops * S_TO_NS / wdata->run_ns;
+		totals[wdata->kind] += rate;
+		squares[wdata->kind] += rate * rate;
+		++counts[wdata->kind];
+		if (!wdata->lat || !wdata->lat->count)
+			continue;
+		if (!kinds[wdata->kind])
+			kinds[wdata->kind] = sketch_new();
+		sketch_merge(kinds[wdata->kind], wdata->lat);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(worker_kind); ++i) {
+		if (totals[i])
+			fprintf(fp, "%s.%s/s %f\n", worker_kind[i],
+				worker_unit[i], totals[i]);
+		if (squares[i])
+			fprintf(fp, "%s.fairness %f\n", worker_kind[i],
+				totals[i] * totals[i] / (counts[i] * squares[i]));
+		if (!kinds[i])
+			continue;
+		fprintf(fp, "%s.lat_avg_us %f\n", worker_kind[i],
+			(double)kinds[i]->sum / kinds[i]->count / US_TO_NS);
+		fprintf(fp, "%s.lat_p50_us %f\n", worker_kind[i],
+			(double)sketch_quantile(kinds[i], 0.50) / US_TO_NS);
+		fprintf(fp, "%s.lat_p99_us %f\n", worker_kind[i],
+			(double)sketch_quantile(kinds[i], 0.99) / US_TO_NS);
+		free(kinds[i]);
+	}
+	for (i = 0; (conf_sleep || conf_spin_margin_us) && i < sleeps_count; ++i) {
+		struct sketch *oversleep = sketch_new();
+		uint32_t w;
+
+		for (w = 0; w < workers_count; ++w)
+			if (workers_data[w].oversleep && workers_data[w].sleep == i)
+				sketch_merge(oversleep, workers_data[w].oversleep);
+		if (oversleep->count)
+			fprintf(fp, "Sleep.%s:%u.oversleep_p99_us %f\n",
+				sleep_name[sleeps[i].mech], sleeps[i].slack_ns,
+				(double)sketch_quantile(oversleep, 0.99) / US_TO_NS);
+		free(oversleep);
+	}
+	if (conf_sleep || conf_spin_margin_us) {
+		uint64_t spin_ns = 0, work_ns = 0;
+
+		for (i = 0; i < workers_count; ++i) {
+			if (!workers_data[i].spin_margin_ns)
+				continue;
+			spin_ns += workers_data[i].spin_ns;
+			work_ns += workers_data[i].work_ns;
+		}
+		if (spin_ns + work_ns)
+			fprintf(fp, "Spin.cpu_pct %f\n",
+				100.0 * spin_ns / (spin_ns + work_ns));
+	}
+	if (conf_rate) {
+		struct sketch *resp = sketch_new();
+		uint64_t served = 0, backlog = 0;
+
+		for (i = 0; i < workers_count; ++i) {
+			if (!workers_data[i].resp)
+				continue;
+			sketch_merge(resp, workers_data[i].resp);
+			served += workers_data[i].resp->count;
+			backlog += workers_data[i].backlog;
+		}
+		if (resp->count) {
+			fprintf(fp, "Interactive.backlog_pct %f\n",
+				100.0 * backlog / (served + backlog));
+			fprintf(fp, "Interactive.resp_p50_us %f\n",
+				(double)sketch_quantile(resp, 0.50) / US_TO_NS);
+			fprintf(fp, "Interactive.resp_p99_us %f\n",
+				(double)sketch_quantile(resp, 0.99) / US_TO_NS);
+		}
+		free(resp);
+	}
+	if (dag && dag->frames + dag->dropped) {
+		fprintf(fp, "Graph.janks_pct %f\n", 100.0
+			* (dag->janks + dag->dropped) / (dag->frames + dag->dropped));
+		fprintf(fp, "Graph.frame_p99_us %f\n",
+			(double)sketch_quantile(dag->lat, 0.99) / US_TO_NS);
+	}
+	if (conf_aw) {
+		uint64_t buffers = 0, underruns = 0;
+
+		for (i = 0; i < conf_aw; ++i) {
+			buffers += audio_paths[i].buffers;
+			underruns += audio_paths[i].underruns;
+		}
+		if (buffers + underruns)
+			fprintf(fp, "Audio.underruns_pct %f\n",
+				100.0 * underruns / (buffers + underruns));
+	}
+	if (conf_tw) {
+		struct sketch *spawn = sketch_new();
+		struct sketch *first_run = sketch_new();
+
+		for (i = 0; i < conf_tw; ++i) {
+			sketch_merge(spawn, churns[i].spawn);
+			sketch_merge(first_run, churns[i].first_run);
+		}
+		if (spawn->count)
+			fprintf(fp, "Thread.spawn_p99_us %f\n",
+				(double)sketch_quantile(spawn, 0.99) / US_TO_NS);
+		if (first_run->count)
+			fprintf(fp, "Thread.first_run_p99_us %f\n",
+				(double)sketch_quantile(first_run, 0.99) / US_TO_NS);
+		free(spawn);
+		free(first_run);
+	}
+	if (conf_ew) {
+		struct sketch *sk[3] = { sketch_new(), sketch_new(), sketch_new() };
+		static const char *names[3] = { "fork", "first_run", "exec" };
+		uint8_t m;
+
+		for (i = 0; i < conf_ew; ++i) {
+			sketch_merge(sk[0], storms[i].fork);
+			sketch_merge(sk[1], storms[i].first_run);
+			sketch_merge(sk[2], storms[i].exec);
+		}
+		for (m = 0; m < 3; ++m) {
+			if (sk[m]->count)
+				fprintf(fp, "Exec.%s_p99_us %f\n", names[m],
+					(double)sketch_quantile(sk[m], 0.99) / US_TO_NS);
+			free(sk[m]);
+		}
+	}
+	if (energy_mj >= 0)
+		fprintf(fp, "energy_mj %f\n", energy_mj);
+	if (conf_sample_ms)
+		fprintf(fp, "throttled_s %f\n", (double)throttle_ns / S_TO_NS);
+}
+
+static void
+report_metrics(void)
+{
+	FILE *fp;
+
+	if (conf_metrics_fd < 0)
+		return;
+
+	fp = fdopen(conf_metrics_fd, "w");
+	if (!fp)
+		barf("fdopen:");
+	metrics_write(fp);
+	fclose(fp);
+}
+
+/* Collect the metrics of a phase, as the ones of an in-process trial */
+static void
+phase_metrics(void)
+{
+	char *buf = NULL, *line, *save;
+	char name[64];
+	double value;
+	size_t size;
+	FILE *fp;
+
+	fp = open_memstream(&buf, &size);
+	if (!fp)
+		barf("open_memstream:");
+	metrics_write(fp);
+	fclose(fp);
+
+	for (line = strtok_r(buf, "\n", &save); line;
+			line = strtok_r(NULL, "\n", &save))
+		if (sscanf(line, "%63s %lf", name, &value) == 2)
+			metric_add(0, name, value);
+	free(buf);
+	metrics_align(0);
+}
+
+/* Results of a phase but the last one, which are reported with the run ones */
+static void
+report_phase(uint32_t phase)
+{
+	if (conf_pool) {
+		phase_metrics();
+		if (!conf_vr)
+			return;
+	}
+
+	printf(FI("Phase %u/%u:\n"), phase + 1, conf_phases);
+	report_workers();
+	report_graph();
+	report_audio();
+	report_thread();
+	report_exec();
+	report_latency();
+}
 
 int
 main(int argc, char *argv[])
 {
 	struct timespec end_ts;
 	char *param = NULL;
-	uint8_t i, w = 0;
+	uint32_t i, w = 0;
 	uint32_t p1, p2;
+	uint32_t phase;
+
+	/* Exec target of the EXEC storm workers */
+	if (argc == 3 && !strcmp(argv[1], "--exec-helper"))
+		return exec_helper(argv[2]);
 
 	pid = gettid();
+	topology_setup();
 
 	/* Compute end test time */
 	clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
@@ -639,18 +6249,69 @@ main(int argc, char *argv[])
 		+ (float)start_ts.tv_nsec / US_TO_NS);
 
 	parse_cmdline(argc, argv);
-	printf(FI("Running for %d [s] with (B,I,P) workers: (%d,%d,%d)\n"),
-			conf_td, conf_bw, conf_iw, conf_pw);
+	if (conf_sweep_point && conf_metrics_fd >= 0)
+		sweep_point_setup();
+	workers_count = conf_bw + conf_iw + conf_pw + conf_yw + conf_fw + conf_mw
+		+ conf_cw + 2 * conf_xw + conf_gw + 2 * conf_aw + conf_tw
+		+ conf_ew + (conf_probe_us ? 1 : 0);
+
+	if (conf_calibrate && conf_metrics_fd < 0) {
+		calibration_run();
+		calibration_print();
+		if (!workers_count)
+			return 0;
+	} else {
+		calibration_load();
+	}
+	if (conf_invariant)
+		calibration_setup();
+	if (conf_power_model)
+		power_model_load();
+	if (conf_trials && !conf_pool && conf_metrics_fd < 0) {
+		run_trials(argv);
+		return 0;
+	}
+	if (conf_sweep && conf_metrics_fd < 0) {
+		run_sweep(argv);
+		return 0;
+	}
+	if (conf_rate_sweep && conf_metrics_fd < 0) {
+		run_rate_sweep(argv);
+		return 0;
+	}
+	/* Replayed schedules come with their seed, otherwise pick a new one */
+	if (conf_sched_replay)
+		schedule_load();
+	if (!conf_seed_set)
+		conf_seed = (uint64_t)time(NULL) << 20 ^ start_ts.tv_nsec ^ pid;
+	printf(FI("Random seed: %llu\n"), (unsigned long long)conf_seed);
+	if (conf_sched_dump) {
+		sched_fp = fopen(conf_sched_dump, "w");
+		if (!sched_fp) {
+			fprintf(stderr, FE("Cannot open schedule [%s]\n"), conf_sched_dump);
+			exit(-1);
+		}
+		fprintf(sched_fp, "# seed %llu\n", (unsigned long long)conf_seed);
+	}
+
+	printf(FI("Running for %u [s] with (B,I,P,Y,F,M,C,H,G,A,T,E) workers: (%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d)\n"),
+			conf_td, conf_bw, conf_iw, conf_pw, conf_yw, conf_fw, conf_mw,
+			conf_cw, 2 * conf_xw, conf_gw, 2 * conf_aw, conf_tw, conf_ew);
 
 	printf(FI("Setup workers..\n"));
 
 	/* Allocate handlers for workers */
-	workers_count = conf_bw + conf_iw + conf_pw + conf_yw;
-	workers = malloc(workers_count + sizeof(pthread_t));
-	workers_data = malloc(workers_count * sizeof(struct wdata));
-
-	/* Lock threads initialization */
-	pthread_mutex_lock(&start_mtx);
+	workers = malloc(workers_count * sizeof(pthread_t));
+	if (posix_memalign((void **)&workers_data, CACHELINE_SIZE,
+			workers_count * sizeof(struct wdata)))
+		barf("posix_memalign:");
+	memset(workers_data, 0, workers_count * sizeof(struct wdata));
+	for (i = 0; i < workers_count; ++i)
+		workers_data[i].cpu = -1;
+
+	/* Workers wait for the main thread to start each phase */
+	if (pthread_barrier_init(&phase_barrier, NULL, workers_count + 1))
+		barf("pthread_barrier_init:");
 
 	/* Allocate BATCH workers */
 	for (i = 0; i < conf_bw; ++i) {
@@ -672,12 +6333,12 @@ main(int argc, char *argv[])
 		workers_data[w+i].kind = WORKER_INTERACTIVE;
 
 		param = strsep(&conf_iparams, ",");
-		sscanf(param, "%d", &p1);
+		p1 = dist_param(param, &workers_data[w+i].dist[0]);
 		param = strsep(&conf_iparams, ",");
-		sscanf(param, "%d", &p2);
+		p2 = dist_param(param, &workers_data[w+i].dist[1]);
 
-		printf(FI("wlg_I%03d: max_interval %6d [us], max_duration %6d [us]\n"),
-			i+1, p1, p2);
+		printf(FI("wlg_I%03d: max_interval %6d [us], max_duration %6d [us]%s\n"),
+			i+1, p1, p2, DIST_NOTE(workers_data+w+i));
 		workers_data[w+i].params.interrupt.interval_max = p1;
 		workers_data[w+i].params.interrupt.duration_max = p2;
 
@@ -693,16 +6354,20 @@ main(int argc, char *argv[])
 		workers_data[w+i].kind = WORKER_PERIODC;
 
 		param = strsep(&conf_pparams, ",");
-		sscanf(param, "%d", &p1);
+		p1 = dist_param(param, &workers_data[w+i].dist[0]);
 		param = strsep(&conf_pparams, ",");
-		sscanf(param, "%d", &p2);
-		if (p2 > 100) {
+		p2 = dist_param(param, &workers_data[w+i].dist[1]);
+		if (p2 > 100 && !workers_data[w+i].dist[1]) {
 			fprintf(stderr, FE("Wrong PERIOD workload specification (duty-cycle > 100)\n"));
 			exit(-1);
 		}
 
-		printf(FI("wlg_P%03d:     interval %6d [us], duty-cycle   %6d [%%]\n"),
-			i+1, p1, p2);
+		if (workers_data[w+i].dist[1])
+			printf(FI("wlg_P%03d:     interval %6d [us], duration     %6d [us]%s\n"),
+				i+1, p1, p2, DIST_NOTE(workers_data+w+i));
+		else
+			printf(FI("wlg_P%03d:     interval %6d [us], duty-cycle   %6d [%%]%s\n"),
+				i+1, p1, p2, DIST_NOTE(workers_data+w+i));
 		workers_data[w+i].params.period.duration =   p1;
 		workers_data[w+i].params.period.duty_cycle = p2;
 
@@ -713,6 +6378,21 @@ main(int argc, char *argv[])
 	}
 	w += i;
 
+	/* Allocate the PROBE worker */
+	if (conf_probe_us) {
+		workers_data[w].id = 0;
+		workers_data[w].pid = 0;
+		workers_data[w].kind = WORKER_PERIODC;
+		workers_data[w].params.period.duration = conf_probe_us;
+		workers_data[w].params.period.duty_cycle = PROBE_DUTY_CYCLE;
+
+		printf(FI("wlg_P000: probe, interval %6d [us], duty-cycle   %6d [%%]\n"),
+			conf_probe_us, PROBE_DUTY_CYCLE);
+
+		workers[w] = create_worker(workers_data+w);
+		++w;
+	}
+
 	/* Allocate YIELD workers */
 	strsep(&conf_yparams, ",");
 	for (i = 0; i < conf_yw; ++i) {
@@ -721,15 +6401,16 @@ main(int argc, char *argv[])
 		workers_data[w+i].kind = WORKER_YIELD;
 
 		param = strsep(&conf_yparams, ",");
-		sscanf(param, "%d", &p1);
+		p1 = dist_param(param, &workers_data[w+i].dist[0]);
 		param = strsep(&conf_yparams, ",");
 		sscanf(param, "%d", &p2);
-		if (p2 > p1) {
+		if (p2 > p1 && !workers_data[w+i].dist[0]) {
 			fprintf(stderr, FE("Wrong YIELD workload specification (period > yield_interval)\n"));
 			exit(-1);
 		}
 
-		printf(FI("wlg_Y%03d:     period %6d [us], yield_interval %6d [us]\n"), i+1, p1, p2);
+		printf(FI("wlg_Y%03d:     period %6d [us], yield_interval %6d [us]%s\n"),
+			i+1, p1, p2, DIST_NOTE(workers_data+w+i));
 		workers_data[w+i].params.yield.period =   p1;
 		workers_data[w+i].params.yield.interval = p2;
 
@@ -737,33 +6418,504 @@ main(int argc, char *argv[])
 	}
 	w += i;
 
-	/* Unlock threads initializartion */
-	pthread_mutex_unlock(&start_mtx);
-	usleep(1000 * w);
-	DB(printf(FD("Wait for workers being ready...\n")));
-	for (i = 0; i < w; ++i) {
-		while (!workers_data[i].pid)
-			usleep(1000);
-		DB(printf(FD("%s ready!\n"), workers_data[i].name));
+	/* Allocate FOOTPRINT workers */
+	strsep(&conf_fparams, ",");
+	for (i = 0; i < conf_fw; ++i) {
+		workers_data[w+i].id = i+1;
+		workers_data[w+i].pid = 0;
+		workers_data[w+i].kind = WORKER_FOOTPRINT;
+
+		param = strsep(&conf_fparams, ",");
+		sscanf(param, "%d", &p1);
+		if (p1 < 1 || p1 > FOOTPRINT_FUNCS) {
+			fprintf(stderr, FE("Wrong FOOTPRINT workload specification (functions not in [1..%d])\n"),
+				FOOTPRINT_FUNCS);
+			exit(-1);
+		}
+		/* Round down to a power of two */
+		for (p2 = 1; (p2 << 1) <= p1; p2 <<= 1);
+
+		printf(FI("wlg_F%03d:   functions %6d\n"), i+1, p2);
+		workers_data[w+i].params.footprint.mask = p2 - 1;
+
+		workers[w+i] = create_worker(workers_data+w+i);
+	}
+	w += i;
+
+	/* Allocate MISPREDICT workers */
+	strsep(&conf_mparams, ",");
+	for (i = 0; i < conf_mw; ++i) {
+		workers_data[w+i].id = i+1;
+		workers_data[w+i].pid = 0;
+		workers_data[w+i].kind = WORKER_MISPREDICT;
+
+		param = strsep(&conf_mparams, ",");
+		sscanf(param, "%d", &p1);
+		if (p1 > 100) {
+			fprintf(stderr, FE("Wrong MISPREDICT workload specification (probability > 100)\n"));
+			exit(-1);
+		}
+
+		printf(FI("wlg_M%03d: taken %6d [%%]\n"), i+1, p1);
+		/* Threshold on random bytes */
+		workers_data[w+i].params.mispredict.threshold = (p1 * 256) / 100;
+		workers_data[w+i].params.mispredict.data = NULL;
+
+		workers[w+i] = create_worker(workers_data+w+i);
+	}
+	w += i;
+
+	/* Allocate CONTENTION workers */
+	strsep(&conf_cparams, ",");
+	if (conf_cw) {
+		param = strsep(&conf_cparams, ",");
+		if (!param || sscanf(param, "%d", &p1) < 1 ||
+				p1 > CONTENTION_LAYOUT_PADDED) {
+			fprintf(stderr, FE("Wrong CONTENTION workload specification (layout)\n"));
+			exit(-1);
+		}
+		param = strsep(&conf_cparams, ",");
+		if (!param || sscanf(param, "%d", &p2) < 1 ||
+				p2 > CONTENTION_OP_STORE) {
+			fprintf(stderr, FE("Wrong CONTENTION workload specification (operation)\n"));
+			exit(-1);
+		}
+		if (posix_memalign((void **)&contention_counters, 4096,
+				conf_cw * CONTENTION_PADDING))
+			barf("posix_memalign:");
+		memset(contention_counters, 0, conf_cw * CONTENTION_PADDING);
+	}
+	for (i = 0; i < conf_cw; ++i) {
+		workers_data[w+i].id = i+1;
+		workers_data[w+i].pid = 0;
+		workers_data[w+i].kind = WORKER_CONTENTION;
+
+		/* Counters within the same line wrap around on big groups */
+		switch (p1) {
+		case CONTENTION_LAYOUT_LINE:
+			param = (char *)contention_counters
+				+ (i * sizeof(uint64_t)) % CACHELINE_SIZE;
+			break;
+		case CONTENTION_LAYOUT_ADJACENT:
+			param = (char *)contention_counters + i * CACHELINE_SIZE;
+			break;
+		default:
+			param = (char *)contention_counters + i * CONTENTION_PADDING;
+		}
+
+		printf(FI("wlg_C%03d:      layout %6d, operation %6d, counter @%p\n"),
+			i+1, p1, p2, param);
+		workers_data[w+i].params.contention.counter = (uint64_t *)param;
+		workers_data[w+i].params.contention.op = p2;
+
+		workers[w+i] = create_worker(workers_data+w+i);
+	}
+	w += i;
+
+	/* Allocate HANDOFF workers */
+	strsep(&conf_xparams, ",");
+	if (conf_xw) {
+		int32_t cpu_p = -1, cpu_c = -1;
+
+		param = strsep(&conf_xparams, ",");
+		if (!param || sscanf(param, "%d", &p1) < 1 || p1 < sizeof(uint64_t)) {
+			fprintf(stderr, FE("Wrong HANDOFF workload specification (buffer size)\n"));
+			exit(-1);
+		}
+		param = strsep(&conf_xparams, ",");
+		if (param && sscanf(param, "%d", &cpu_p) < 1)
+			cpu_p = -1;
+		param = strsep(&conf_xparams, ",");
+		if (param && sscanf(param, "%d", &cpu_c) < 1)
+			cpu_c = -1;
+		if (cpu_p >= cpus_count || cpu_c >= cpus_count) {
+			fprintf(stderr, FE("Wrong HANDOFF workload specification (CPU)\n"));
+			exit(-1);
+		}
+
+		if (posix_memalign((void **)&handoff_pairs, CACHELINE_SIZE,
+				conf_xw * sizeof(struct handoff)))
+			barf("posix_memalign:");
+		memset(handoff_pairs, 0, conf_xw * sizeof(struct handoff));
+
+		for (i = 0; i < conf_xw; ++i) {
+			handoff_pairs[i].words = p1 / sizeof(uint64_t);
+			if (posix_memalign((void **)&handoff_pairs[i].buffer,
+					CACHELINE_SIZE, p1))
+				barf("posix_memalign:");
+			memset(handoff_pairs[i].buffer, 0, p1);
+		}
+
+		for (i = 0; i < 2 * conf_xw; ++i) {
+			workers_data[w+i].id = i+1;
+			workers_data[w+i].pid = 0;
+			workers_data[w+i].kind = WORKER_HANDOFF;
+			workers_data[w+i].cpu = (i % 2) ? cpu_c : cpu_p;
+			workers_data[w+i].params.handoff.pair = handoff_pairs + i / 2;
+			workers_data[w+i].params.handoff.producer = !(i % 2);
+
+			printf(FI("wlg_H%03d: %s %6d [bytes], CPU %d\n"), i+1,
+				(i % 2) ? "consumer" : "producer", p1,
+				workers_data[w+i].cpu);
+
+			workers[w+i] = create_worker(workers_data+w+i);
+		}
+	}
+	w += 2 * conf_xw;
+
+	/* Allocate GRAPH workers */
+	strsep(&conf_gparams, ",");
+	if (conf_gw) {
+		struct dag_node *node;
+		char *preds;
+
+		param = strsep(&conf_gparams, ",");
+		if (!param || sscanf(param, "%d", &p1) < 1 || !p1) {
+			fprintf(stderr, FE("Wrong GRAPH workload specification (period)\n"));
+			exit(-1);
+		}
+		if (posix_memalign((void **)&dag, CACHELINE_SIZE, sizeof(struct dag)))
+			barf("posix_memalign:");
+		memset(dag, 0, sizeof(struct dag));
+		pthread_mutex_init(&dag->stats_mtx, NULL);
+		dag->lat = sketch_new();
+		dag->period_us = p1;
+		dag->nodes_count = conf_gw;
+
+		for (i = 0; i < conf_gw; ++i) {
+			node = dag->nodes + i;
+			param = strsep(&conf_gparams, ",");
+			preds = param;
+			if (!param || sscanf(strsep(&preds, ":"), "%u", &node->burst_us) < 1) {
+				fprintf(stderr, FE("Wrong GRAPH workload specification (task %d)\n"), i+1);
+				exit(-1);
+			}
+			while (preds && (param = strsep(&preds, "+"))) {
+				if (sscanf(param, "%d", &p2) < 1 || p2 < 1 || p2 > i) {
+					fprintf(stderr, FE("Wrong GRAPH workload specification (task %d dependencies)\n"), i+1);
+					exit(-1);
+				}
+				dag->nodes[p2-1].succs[dag->nodes[p2-1].succs_count++] = i;
+				++node->preds_count;
+			}
+			/* Source nodes wait for the vsync */
+			if (i && !node->preds_count) {
+				node->source = 1;
+				node->preds_count = 1;
+			}
+			for (p2 = 0; p2 < DAG_FRAMES; ++p2)
+				node->remaining[p2] = node->preds_count;
+			sem_init(&node->ready, 0, 0);
+		}
+		for (i = 0; i < conf_gw; ++i) {
+			node = dag->nodes + i;
+			node->sink = !node->succs_count;
+			dag->sinks_count += node->sink;
+		}
+	}
+	for (i = 0; i < conf_gw; ++i) {
+		workers_data[w+i].id = i+1;
+		workers_data[w+i].pid = 0;
+		workers_data[w+i].kind = WORKER_GRAPH;
+		workers_data[w+i].params.graph.dag = dag;
+		workers_data[w+i].params.graph.node = i;
+
+		if (!i)
+			printf(FI("wlg_G%03d: max_duration %6d [us], vsync every %6d [us]\n"),
+				i+1, dag->nodes[i].burst_us, dag->period_us);
+		else
+			printf(FI("wlg_G%03d: max_duration %6d [us], dependencies %d%s\n"),
+				i+1, dag->nodes[i].burst_us, dag->nodes[i].preds_count,
+				dag->nodes[i].source ? " (vsync)" : "");
+
+		workers[w+i] = create_worker(workers_data+w+i);
+	}
+	w += conf_gw;
+
+	/* Allocate AUDIO workers */
+	strsep(&conf_aparams, ",");
+	if (conf_aw) {
+		uint32_t ring, duty;
+
+		param = strsep(&conf_aparams, ",");
+		if (!param || sscanf(param, "%d", &p1) < 1 || !p1) {
+			fprintf(stderr, FE("Wrong AUDIO workload specification (period)\n"));
+			exit(-1);
+		}
+		param = strsep(&conf_aparams, ",");
+		if (!param || sscanf(param, "%u", &ring) < 1 || ring < 2) {
+			fprintf(stderr, FE("Wrong AUDIO workload specification (ring of at least 2 buffers)\n"));
+			exit(-1);
+		}
+		param = strsep(&conf_aparams, ",");
+		if (!param || sscanf(param, "%u", &duty) < 1 || duty > 100) {
+			fprintf(stderr, FE("Wrong AUDIO workload specification (duty-cycle > 100)\n"));
+			exit(-1);
+		}
+
+		if (posix_memalign((void **)&audio_paths, CACHELINE_SIZE,
+				conf_aw * sizeof(struct audio)))
+			barf("posix_memalign:");
+		memset(audio_paths, 0, conf_aw * sizeof(struct audio));
+
+		for (i = 0; i < conf_aw; ++i) {
+			audio_paths[i].period_us = p1;
+			audio_paths[i].burst_us = (uint64_t)p1 * duty / 100;
+			audio_paths[i].ring_size = ring;
+			audio_paths[i].late = sketch_new();
+			audio_paths[i].ring = calloc(ring * AUDIO_SAMPLES,
+					sizeof(uint32_t));
+			if (!audio_paths[i].ring)
+				barf("calloc:");
+		}
+
+		for (i = 0; i < 2 * conf_aw; ++i) {
+			workers_data[w+i].id = i+1;
+			workers_data[w+i].pid = 0;
+			workers_data[w+i].kind = WORKER_AUDIO;
+			workers_data[w+i].params.audio.path = audio_paths + i / 2;
+			workers_data[w+i].params.audio.producer = !(i % 2);
+
+			printf(FI("wlg_A%03d: %s period %6d [us], ring %3u buffers, duty-cycle %3u [%%]\n"),
+				i+1, (i % 2) ? "consumer" : "producer", p1, ring, duty);
+
+			workers[w+i] = create_worker(workers_data+w+i);
+		}
+	}
+	w += 2 * conf_aw;
+
+	/* Allocate THREAD churn workers */
+	strsep(&conf_tparams, ",");
+	if (conf_tw) {
+		uint32_t rate, concurrency;
+
+		param = strsep(&conf_tparams, ",");
+		if (!param || sscanf(param, "%u", &rate) < 1) {
+			fprintf(stderr, FE("Wrong THREAD workload specification (rate)\n"));
+			exit(-1);
+		}
+		param = strsep(&conf_tparams, ",");
+		if (!param || sscanf(param, "%u", &concurrency) < 1 ||
+				!concurrency || concurrency > CHURN_SLOTS_MAX) {
+			fprintf(stderr, FE("Wrong THREAD workload specification (concurrency not in [1..%d])\n"),
+				CHURN_SLOTS_MAX);
+			exit(-1);
+		}
+		param = strsep(&conf_tparams, ",");
+
+		churns = calloc(conf_tw, sizeof(struct churn));
+		if (!churns)
+			barf("calloc:");
+		for (i = 0; i < conf_tw; ++i) {
+			churns[i].rate = rate;
+			churns[i].concurrency = concurrency;
+			churns[i].slots = calloc(concurrency, sizeof(struct churn_slot));
+			if (!churns[i].slots)
+				barf("calloc:");
+			if (pthread_attr_init(&churns[i].attr) ||
+					pthread_attr_setdetachstate(&churns[i].attr,
+						PTHREAD_CREATE_DETACHED))
+				barf("pthread_attr_init:");
+			churns[i].spawn = sketch_new();
+			churns[i].first_run = sketch_new();
+			churns[i].lifetime = sketch_new();
+		}
+
+		for (i = 0; i < conf_tw; ++i) {
+			workers_data[w+i].id = i+1;
+			workers_data[w+i].pid = 0;
+			workers_data[w+i].kind = WORKER_THREAD;
+			workers_data[w+i].params.thread.churn = churns + i;
+			p1 = dist_param(param, &workers_data[w+i].dist[0]);
+			churns[i].burst_us = p1;
+
+			printf(FI("wlg_T%03d: rate %6u [threads/s], concurrency %4u, max_duration %6d [us]%s\n"),
+				i+1, rate, concurrency, p1, DIST_NOTE(workers_data+w+i));
+
+			workers[w+i] = create_worker(workers_data+w+i);
+		}
+	}
+	w += conf_tw;
+
+	/* Allocate EXEC storm workers */
+	strsep(&conf_eparams, ",");
+	if (conf_ew) {
+		uint32_t rate;
+		uint8_t mode = STORM_FORK;
+
+		param = strsep(&conf_eparams, ",");
+		if (!param || sscanf(param, "%u", &rate) < 1) {
+			fprintf(stderr, FE("Wrong EXEC workload specification (rate)\n"));
+			exit(-1);
+		}
+		param = strsep(&conf_eparams, ",");
+		if (param && !strcmp(param, "self"))
+			mode = STORM_SELF;
+		else if (param && strcmp(param, "fork"))
+			mode = STORM_PATH;
+		if (mode == STORM_PATH && access(param, X_OK)) {
+			fprintf(stderr, FE("Wrong EXEC workload specification (cannot execute [%s])\n"),
+				param);
+			exit(-1);
+		}
+
+		storms = calloc(conf_ew, sizeof(struct storm));
+		if (!storms)
+			barf("calloc:");
+		for (i = 0; i < conf_ew; ++i) {
+			storms[i].rate = rate;
+			storms[i].mode = mode;
+			storms[i].path = param;
+			if (pipe(storms[i].pipe_fd))
+				barf("pipe:");
+			/* The helper may fail to report, never block on it */
+			fcntl(storms[i].pipe_fd[0], F_SETFL, O_NONBLOCK);
+			fcntl(storms[i].pipe_fd[0], F_SETFD, FD_CLOEXEC);
+			snprintf(storms[i].fd_str, sizeof(storms[i].fd_str), "%d",
+				storms[i].pipe_fd[1]);
+			storms[i].child = mmap(NULL, sizeof(struct storm_child),
+				PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+				-1, 0);
+			if (storms[i].child == MAP_FAILED)
+				barf("mmap:");
+			storms[i].fork = sketch_new();
+			storms[i].first_run = sketch_new();
+			storms[i].exec = sketch_new();
+			storms[i].total = sketch_new();
+		}
+
+		for (i = 0; i < conf_ew; ++i) {
+			workers_data[w+i].id = i+1;
+			workers_data[w+i].pid = 0;
+			workers_data[w+i].kind = WORKER_EXEC;
+			workers_data[w+i].params.exec.storm = storms + i;
+
+			printf(FI("wlg_E%03d: rate %6u [processes/s], %s%s\n"),
+				i+1, rate, (mode == STORM_FORK) ? "fork and exit" :
+				(mode == STORM_SELF) ? "fork and exec wlg" :
+				"fork and exec ", (mode == STORM_PATH) ? param : "");
+
+			workers[w+i] = create_worker(workers_data+w+i);
+		}
+	}
+	w += conf_ew;
+
+	if (sched_fp) {
+		fclose(sched_fp);
+		printf(FI("Activations schedule written into %s\n"), conf_sched_dump);
 	}
 
-	pthread_mutex_lock(&start_mtx);
 	DB(printf(FI("Start workers...\n")));
-	pthread_cond_broadcast(&start_cv);
-	clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
-	pthread_mutex_unlock(&start_mtx);
+	for (phase = 0; phase < conf_phases; ++phase) {
+		if (phase)
+			phase_arm(phase);
+
+		clock_gettime(CLOCK_MONOTONIC_RAW, &phase_ts);
+		if (!phase)
+			start_ts = phase_ts;
+		meas_start_ns = timespec_nanoseconds(&phase_ts)
+			+ (uint64_t)conf_warmup_ms * MS_TO_NS;
+		meas_end_ns = timespec_nanoseconds(&phase_ts)
+			+ (uint64_t)conf_td * S_TO_NS - (uint64_t)conf_cooldown_ms * MS_TO_NS;
+		pthread_barrier_wait(&phase_barrier);
+		if (!phase) {
+			sampling_start();
+			pelt_start();
+			printf(FI("Wait for workers termination...\n"));
+		}
+
+		/* Workers park at the end of the phase */
+		pthread_barrier_wait(&phase_barrier);
+		sampling_phase_end();
+		if (phase + 1 < conf_phases || conf_pool)
+			report_phase(phase);
+	}
 
-	printf(FI("Wait for workers termination...\n"));
 	for (i = 0; i < w; ++i) {
 		pthread_join(workers[i], NULL);
 		DB(printf(FD("%s joined!\n"), workers_data[i].name));
 	}
+	sampling_stop();
+	pelt_stop();
+	pthread_barrier_destroy(&phase_barrier);
 
 	/* Compute end test time */
 	clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
 	timespec_subtract(&end_ts, &start_ts);
 	printf(FI("Time: %lu.%lu\n"), end_ts.tv_sec, end_ts.tv_nsec / MS_TO_NS);
 
+	if (conf_pool) {
+		report_trials();
+	} else {
+		if (conf_phases > 1)
+			printf(FI("Phase %u/%u:\n"), conf_phases, conf_phases);
+		if (conf_warmup_ms || conf_cooldown_ms)
+			printf(FI("Measurement window: [%.3f, %.3f] [s]\n"),
+				(double)conf_warmup_ms / S_TO_MS,
+				(double)conf_td - (double)conf_cooldown_ms / S_TO_MS);
+		printf(FI("Random seed: %llu%s%s\n"), (unsigned long long)conf_seed,
+			conf_sched_replay ? ", replaying " : "",
+			conf_sched_replay ? conf_sched_replay : "");
+		report_workers();
+		report_graph();
+		report_audio();
+		report_thread();
+		report_exec();
+		report_latency();
+		report_bursts();
+		report_pelt();
+		report_sampling();
+		report_thermal();
+		report_energy();
+		report_attribution();
+		report_metrics();
+	}
+
+	free(contention_counters);
+	for (i = 0; i < conf_xw; ++i)
+		free(handoff_pairs[i].buffer);
+	free(handoff_pairs);
+	for (i = 0; i < workers_count; ++i) {
+		dist_free(workers_data[i].dist[0]);
+		dist_free(workers_data[i].dist[1]);
+	}
+	for (i = 0; i < conf_aw; ++i) {
+		free(audio_paths[i].ring);
+		free(audio_paths[i].late);
+	}
+	free(audio_paths);
+	for (i = 0; i < conf_tw; ++i) {
+		pthread_attr_destroy(&churns[i].attr);
+		free(churns[i].slots);
+		free(churns[i].spawn);
+		free(churns[i].first_run);
+		free(churns[i].lifetime);
+	}
+	free(churns);
+	for (i = 0; i < phase_specs_count; ++i)
+		free(phase_specs[i].values);
+	for (i = 0; i < conf_ew; ++i) {
+		close(storms[i].pipe_fd[0]);
+		close(storms[i].pipe_fd[1]);
+		munmap(storms[i].child, sizeof(struct storm_child));
+		free(storms[i].fork);
+		free(storms[i].first_run);
+		free(storms[i].exec);
+		free(storms[i].total);
+	}
+	free(storms);
+	if (dag) {
+		for (i = 0; i < dag->nodes_count; ++i)
+			sem_destroy(&dag->nodes[i].ready);
+		free(dag->lat);
+		free(dag);
+	}
+	for (i = 0; i < schedules_count; ++i) {
+		free(schedules[i].sleep_us);
+		free(schedules[i].burst_us);
+	}
+	free(schedules);
+
 	return 0;
 
 }
@@ -0,0 +1,74 @@
+/*
+This file is part of wlg - A pretty simple workload mix generator
+Copyright (C) 2014 Patrick Bellasi <derkling@gmail.com>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef WLG_LOG_H
+#define WLG_LOG_H
+
+#include <stdint.h>
+
+/*
+ * Binary events log format
+ *
+ * Each worker writes its own file, made of a fixed size header followed by
+ * an array of fixed size event records. Records are stored in host byte
+ * order, the header magic allows the analysis tool to tell if a file has
+ * been produced by a different version of wlg.
+ */
+
+#define WLG_LOG_MAGIC   "WLGEVT01"
+#define WLG_LOG_VERSION 2
+
+struct wlg_log_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t record_size;
+	uint32_t tid;
+	uint16_t id;
+	/* Worker kind, or WLG_LOG_KIND_SAMPLER */
+	uint8_t kind;
+	uint8_t pad;
+	char name[16];
+	/* Test start time, events timestamps are relative to it */
+	uint64_t start_ns;
+	/* Number of valid records following the header */
+	uint64_t count;
+};
+
+/* Log of the platform sampler, rather than of a worker */
+#define WLG_LOG_KIND_SAMPLER 0xff
+
+/* Events types */
+#define WLG_EV_WAKEUP 0 /* Woken up from sleep, arg: wakeup latency [ns] */
+#define WLG_EV_START  1 /* Activation started, arg: expected duration [ns] */
+#define WLG_EV_END    2 /* Activation completed, arg: actual duration [ns] */
+/* Since version 2, only in the sampler log */
+#define WLG_EV_THROTTLE_START 3 /* CPUs throttled, arg: frequency cap [kHz] */
+#define WLG_EV_THROTTLE_END   4 /* CPUs unthrottled, arg: duration [ns] */
+#define WLG_EV_MAX    5
+
+struct wlg_log_event {
+	uint64_t ts_ns;
+	/* Saturates at UINT32_MAX, i.e. ~4.3 [s] */
+	uint32_t arg;
+	int16_t cpu;
+	uint8_t type;
+	uint8_t pad;
+};
+
+#endif /* WLG_LOG_H */